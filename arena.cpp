@@ -0,0 +1,156 @@
+//
+//  arena.cpp
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "arena.h"
+#include "worker.h"
+
+namespace wkfw {
+
+// Размер обычного куска арены
+static const size_t CHUNK_SIZE = 4 << 20;
+
+// Размер огромной страницы
+static const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+// Сколько освобожденных обычных кусков остается отображенными для следующих
+// арен: короткоживущие арены (порции строк) не платят за отображение
+// и первое обращение к каждой странице
+static const size_t CACHED_CHUNKS = 4;
+
+static std::mutex cachedChunksMutex;
+
+/**
+ * Освобожденные обычные куски. Не разрушается при завершении процесса,
+ * так как арены статических объектов могут пережить его.
+ */
+static std::vector<char*>& getCachedChunks() {
+  static std::vector<char*>* chunks = new std::vector<char*>();
+  return *chunks;
+}
+
+/**
+ * @return Обычный кусок из освобожденных или nullptr.
+ */
+static char* takeCachedChunk() {
+  std::lock_guard<std::mutex> lock(cachedChunksMutex);
+  std::vector<char*>& chunks = getCachedChunks();
+  if (chunks.empty())
+    return nullptr;
+  char* chunk = chunks.back();
+  chunks.pop_back();
+  return chunk;
+}
+
+MemoryBudget::Reservation::Reservation(std::shared_ptr<MemoryBudget> budget,
+                                       const size_t size)
+    : budget(budget), size(size) {
+  if (budget && !budget->reserve(size))
+    throw MemoryLimitException();
+}
+
+Arena::~Arena() {
+  for (auto const& chunk : chunks) {
+    if (chunk.second == CHUNK_SIZE) {
+      std::lock_guard<std::mutex> lock(cachedChunksMutex);
+      if (getCachedChunks().size() < CACHED_CHUNKS) {
+        getCachedChunks().push_back(chunk.first);
+        continue;
+      }
+    }
+    munmap(chunk.first, chunk.second);
+  }
+  if (budget)
+    budget->release(total);
+}
+
+char* Arena::allocate(const size_t size) {
+  // Выравнивание не требуется: в арене хранятся только байты строк
+  std::lock_guard<std::mutex> lock(mutex);
+  if ((size_t)(end - position) >= size) {
+    char* result = position;
+    position += size;
+    return result;
+  }
+
+  // Большие участки получают отдельный кусок, текущий кусок остается
+  const size_t chunkSize = std::max(size, CHUNK_SIZE);
+  if (budget && !budget->reserve(chunkSize))
+    throw MemoryLimitException();
+  void* mapped = chunkSize == CHUNK_SIZE ? takeCachedChunk() : nullptr;
+  if (mapped == nullptr) {
+    mapped = mmap(nullptr, chunkSize, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) {
+      if (budget)
+        budget->release(chunkSize);
+      throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if (chunkSize >= HUGE_PAGE_SIZE)
+      madvise(mapped, chunkSize, MADV_HUGEPAGE);
+#endif
+  }
+  chunks.push_back(std::make_pair((char*)mapped, chunkSize));
+  total += chunkSize;
+
+  char* result = (char*)mapped;
+  if (chunkSize - size > (size_t)(end - position)) {
+    position = result + size;
+    end = result + chunkSize;
+  }
+  return result;
+}
+
+char* Arena::resize(char* block, const size_t size, const size_t newSize) {
+  if (newSize <= size)
+    return block;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (block + size == position && (size_t)(end - block) >= newSize) {
+      position = block + newSize;
+      return block;
+    }
+
+#ifdef MREMAP_MAYMOVE
+    // Кусок ровно по размеру участка выделен только под него
+    for (auto chunk = chunks.rbegin(); chunk != chunks.rend(); ++chunk) {
+      if (chunk->first != block || chunk->second != size)
+        continue;
+      if (budget && !budget->reserve(newSize - size))
+        throw MemoryLimitException();
+      void* mapped = mremap(block, size, newSize, MREMAP_MAYMOVE);
+      if (mapped == MAP_FAILED) {
+        if (budget)
+          budget->release(newSize - size);
+        throw std::bad_alloc();
+      }
+      *chunk = std::make_pair((char*)mapped, newSize);
+      total += newSize - size;
+      return (char*)mapped;
+    }
+#endif
+  }
+
+  char* result = allocate(newSize);
+  memcpy(result, block, size);
+  return result;
+}
+
+size_t Arena::getSize() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return total;
+}
+
+}  // namespace wkfw
@@ -0,0 +1,152 @@
+//
+//  arena.h
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace wkfw {
+
+/**
+ * Учет памяти исполнения: арены и рабочие буферы блоков сообщают
+ * о выделенной памяти, и выделение сверх ограничения не допускается.
+ * Исполнитель по свободному остатку выбирает, исполнять ли схему в памяти
+ * или потоково со сбросом частей сортировки на диск.
+ *
+ * Учет потокобезопасен и может разделяться несколькими Workflow.
+ */
+class MemoryBudget {
+ public:
+  /**
+   * @param limit Ограничение в байтах.
+   */
+  explicit MemoryBudget(const size_t limit) : limit(limit), used(0) {}
+  MemoryBudget(const MemoryBudget&) = delete;
+  MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+  /**
+   * Учитывает выделение, если оно не превышает ограничение.
+   *
+   * @return false, если памяти недостаточно, выделение не учтено.
+   */
+  bool reserve(const size_t size) {
+    size_t current = used.load();
+    do {
+      if (size > limit || current > limit - size)
+        return false;
+    } while (!used.compare_exchange_weak(current, current + size));
+    return true;
+  }
+
+  void release(const size_t size) { used -= size; }
+
+  size_t getLimit() const { return limit; }
+
+  size_t getUsed() const { return used.load(); }
+
+  size_t getAvailable() const {
+    const size_t current = used.load();
+    return current < limit ? limit - current : 0;
+  }
+
+  /**
+   * Учтенная память, освобождаемая при уничтожении.
+   */
+  class Reservation {
+   public:
+    /**
+     * @param budget Учет памяти или nullptr - без ограничения.
+     *
+     * @throw MemoryLimitException Если память превысила бы ограничение.
+     */
+    Reservation(std::shared_ptr<MemoryBudget> budget, const size_t size);
+    Reservation(const Reservation&) = delete;
+    Reservation& operator=(const Reservation&) = delete;
+    ~Reservation() {
+      if (budget)
+        budget->release(size);
+    }
+
+   private:
+    const std::shared_ptr<MemoryBudget> budget;
+    const size_t size;
+  };
+
+ private:
+  const size_t limit;
+  std::atomic<size_t> used;
+};
+
+/**
+ * Монотонная арена: память выделяется из больших кусков и не освобождается
+ * по отдельности, все куски освобождаются разом вместе с ареной.
+ * Куски отображаются в память напрямую, большие - с просьбой
+ * использовать огромные страницы.
+ *
+ * Выделение потокобезопасно. Строки текста размещаются через TextBuilder,
+ * который берет у арены блоки и делит их без блокировок.
+ * Отображенные куски учитываются в MemoryBudget, если он задан.
+ */
+class Arena {
+ public:
+  /**
+   * @param budget Учет памяти или nullptr - без ограничения.
+   */
+  explicit Arena(std::shared_ptr<MemoryBudget> budget = nullptr)
+      : budget(budget), position(nullptr), end(nullptr), total(0) {}
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  ~Arena();
+
+  /**
+   * Выделяет непрерывный участок памяти.
+   *
+   * @throw std::bad_alloc Если память не удалось отобразить.
+   * @throw MemoryLimitException Если память превысила бы ограничение.
+   */
+  char* allocate(const size_t size);
+
+  /**
+   * Увеличивает участок, выделенный allocate или resize. Последний выделенный
+   * участок продолжается на месте, участок в отдельном куске переотображается,
+   * остальные копируются в новый участок (старый остается за ареной).
+   *
+   * @return Начало участка, прежнее содержимое сохранено.
+   * @throw std::bad_alloc Если память не удалось отобразить.
+   * @throw MemoryLimitException Если память превысила бы ограничение.
+   */
+  char* resize(char* block, const size_t size, const size_t newSize);
+
+  /**
+   * @return Объем отображенной ареной памяти в байтах.
+   */
+  size_t getSize() const;
+
+  /**
+   * @return Учет памяти арены или nullptr.
+   */
+  std::shared_ptr<MemoryBudget> getBudget() const { return budget; }
+
+ private:
+  const std::shared_ptr<MemoryBudget> budget;
+  mutable std::mutex mutex;
+  std::vector<std::pair<char*, size_t>> chunks;
+  char* position;
+  char* end;
+  size_t total;
+};
+
+}  // namespace wkfw
+
+#endif /* ARENA_H_ */
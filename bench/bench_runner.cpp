@@ -0,0 +1,261 @@
+//
+//  bench_runner.cpp
+//  WorkflowBench
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Сквозной замер: прогоняет эталонные схемы через исполняемый файл Workflow,
+ * измеряет пропускную способность и пиковое потребление памяти,
+ * сравнивает их с сохраненными базовыми значениями.
+ */
+
+/**
+ * Параметры запуска замеров.
+ */
+struct BenchOptions {
+  std::string binary = "./Workflow";
+  std::string input;
+  std::string baselines = "baselines.txt";
+  double threshold = 0.1;
+  size_t repeat = 3;
+  bool update = false;
+  std::vector<std::string> workflows;
+};
+
+/**
+ * Результат замера одной схемы.
+ */
+struct Measurement {
+  double throughput = 0;  // МБ/с
+  long peakRss = 0;       // КБ
+};
+
+static std::string baseName(const std::string& path) {
+  size_t slash = path.find_last_of('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+/**
+ * Запускает Workflow над входным файлом.
+ *
+ * @param seconds Время выполнения.
+ * @param peakRss Пиковый объем резидентной памяти процесса в КБ.
+ *
+ * @return true, если процесс завершился успешно и ничего не вывел в stderr.
+ */
+static bool runOnce(const BenchOptions& options,
+                    const std::string& workflow,
+                    double& seconds,
+                    long& peakRss) {
+  const std::string output = "._bench_output_";
+  const std::string errors = "._bench_errors_";
+  auto start = std::chrono::steady_clock::now();
+
+  pid_t pid = fork();
+  if (pid < 0)
+    return false;
+
+  if (pid == 0) {
+    int fd = open(errors.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0)
+      dup2(fd, STDERR_FILENO);
+    execl(options.binary.c_str(), options.binary.c_str(), "-i",
+          options.input.c_str(), "-o", output.c_str(), workflow.c_str(),
+          (char*)nullptr);
+    _exit(127);
+  }
+
+  int status = 0;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) < 0)
+    return false;
+
+  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                          start)
+                .count();
+  peakRss = usage.ru_maxrss;
+
+  struct stat info;
+  bool silent = stat(errors.c_str(), &info) == 0 && info.st_size == 0;
+  if (!silent) {
+    std::ifstream log(errors);
+    std::cerr << log.rdbuf();
+  }
+
+  remove(output.c_str());
+  remove(errors.c_str());
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 && silent;
+}
+
+static std::map<std::string, Measurement> loadBaselines(
+    const std::string& filename) {
+  std::map<std::string, Measurement> baselines;
+  std::ifstream input(filename);
+  std::string line;
+
+  while (std::getline(input, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream fields(line);
+    std::string name;
+    Measurement value;
+    if (fields >> name >> value.throughput >> value.peakRss)
+      baselines[name] = value;
+  }
+
+  return baselines;
+}
+
+static bool saveBaselines(const std::string& filename,
+                          const std::map<std::string, Measurement>& baselines) {
+  std::ofstream output(filename);
+  if (!output.is_open())
+    return false;
+
+  output << "# workflow throughput(MB/s) peak_rss(KB)" << std::endl;
+  for (auto const& entry : baselines)
+    output << entry.first << " " << std::fixed << std::setprecision(2)
+           << entry.second.throughput << " " << entry.second.peakRss
+           << std::endl;
+  return (bool)output;
+}
+
+static bool parseOptions(const std::vector<std::string>& args,
+                         BenchOptions& options) {
+  for (auto i = args.begin(); i < args.end(); i++) {
+    if ((*i)[0] != '-') {  // Не название опции
+      options.workflows.push_back(*i);
+    } else if ((*i) == "--update") {
+      options.update = true;
+    } else if ((i + 1) == args.end()) {  // Опции с аргументами
+      std::cerr << "Option " << *i << " is not set." << std::endl;
+      return false;
+    } else if ((*i) == "-b") {
+      options.binary = *++i;
+    } else if ((*i) == "-i") {
+      options.input = *++i;
+    } else if ((*i) == "-s") {
+      options.baselines = *++i;
+    } else if ((*i) == "-t") {
+      options.threshold = std::stod(*++i);
+    } else if ((*i) == "-r") {
+      options.repeat = std::stoul(*++i);
+    } else {
+      std::cerr << "Unknown option: " << *i << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, const char* argv[]) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  BenchOptions options;
+
+  try {
+    if (!parseOptions(args, options))
+      return 1;
+  } catch (const std::logic_error& e) {
+    std::cerr << "Invalid option value." << std::endl;
+    return 1;
+  }
+
+  // Проверка наличия параметров
+  if (options.input == "") {
+    std::cerr << "No benchmark input file." << std::endl;
+    return 1;
+  }
+  if (options.workflows.empty()) {
+    std::cerr << "No workflow files to benchmark." << std::endl;
+    return 1;
+  }
+
+  struct stat info;
+  if (stat(options.input.c_str(), &info) != 0) {
+    std::cerr << "Cannot open file: \"" << options.input << "\"" << std::endl;
+    return 1;
+  }
+  double megabytes = info.st_size / (1024.0 * 1024.0);
+
+  std::map<std::string, Measurement> baselines =
+      loadBaselines(options.baselines);
+  bool failed = false;
+
+  std::cout << std::left << std::setw(24) << "workflow" << std::right
+            << std::setw(12) << "MB/s" << std::setw(14) << "peak KB"
+            << "  status" << std::endl;
+
+  for (auto const& workflow : options.workflows) {
+    const std::string name = baseName(workflow);
+    Measurement current;
+    bool success = true;
+
+    // Лучшее время и наибольший пик памяти среди повторов
+    double best = 0;
+    for (size_t run = 0; run < options.repeat && success; run++) {
+      double seconds = 0;
+      long peakRss = 0;
+      success = runOnce(options, workflow, seconds, peakRss);
+      if (run == 0 || seconds < best)
+        best = seconds;
+      if (peakRss > current.peakRss)
+        current.peakRss = peakRss;
+    }
+    current.throughput = best > 0 ? megabytes / best : 0;
+
+    std::string status;
+    auto baseline = baselines.find(name);
+    if (!success) {
+      status = "FAILED";
+      failed = true;
+    } else if (options.update) {
+      baselines[name] = current;
+      status = "updated";
+    } else if (baseline == baselines.end()) {
+      status = "no baseline";
+    } else if (current.throughput <
+               baseline->second.throughput * (1 - options.threshold)) {
+      status = "REGRESSION (throughput)";
+      failed = true;
+    } else if (current.peakRss >
+               baseline->second.peakRss * (1 + options.threshold)) {
+      status = "REGRESSION (memory)";
+      failed = true;
+    } else {
+      status = "ok";
+    }
+
+    std::cout << std::left << std::setw(24) << name << std::right
+              << std::setw(12) << std::fixed << std::setprecision(2)
+              << current.throughput << std::setw(14) << current.peakRss
+              << "  " << status << std::endl;
+  }
+
+  if (options.update && !saveBaselines(options.baselines, baselines)) {
+    std::cerr << "Cannot write baselines to file \"" << options.baselines
+              << "\"" << std::endl;
+    return 1;
+  }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,229 @@
+//
+//  corpus_generator.cpp
+//  WorkflowBench
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Генератор синтетического корпуса логов для сквозных замеров.
+ *
+ * Результат полностью определяется параметрами запуска: используется
+ * собственный генератор псевдослучайных чисел и собственные преобразования
+ * распределений вместо зависящих от реализации std::*_distribution.
+ */
+
+/**
+ * Параметры генерации корпуса.
+ */
+struct CorpusOptions {
+  uint64_t size = 64 * 1024 * 1024;
+  uint64_t seed = 1;
+  double lengthMean = 120;
+  double lengthDeviation = 40;
+  size_t vocabulary = 5000;
+  double duplicateRate = 0.1;
+  std::string output;
+};
+
+static const double PI = 3.14159265358979323846;
+
+/**
+ * Генератор псевдослучайных чисел splitmix64.
+ */
+class Random {
+ public:
+  Random(uint64_t seed) : state(seed) {}
+
+  uint64_t next() {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+  /**
+   * @return Равномерно распределенное число из [0, 1).
+   */
+  double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+  /**
+   * @return Равномерно распределенное число из [0, bound).
+   */
+  uint64_t below(uint64_t bound) { return next() % bound; }
+
+  /**
+   * @return Нормально распределенное число (преобразование Бокса-Мюллера).
+   */
+  double normal(double mean, double deviation) {
+    double u1 = 1.0 - uniform();
+    double u2 = uniform();
+    return mean +
+           deviation * std::sqrt(-2.0 * std::log(u1)) * std::cos(2 * PI * u2);
+  }
+
+ private:
+  uint64_t state;
+};
+
+static const char* const LEVELS[] = {"DEBUG", "INFO", "INFO", "INFO",
+                                     "WARN",  "ERROR"};
+static const size_t LEVELS_COUNT = sizeof(LEVELS) / sizeof(LEVELS[0]);
+static const size_t HOSTS_COUNT = 64;
+static const size_t RECENT_LINES = 1024;
+
+/**
+ * Словарь слов с распределением Ципфа по частоте использования.
+ */
+class Vocabulary {
+ public:
+  Vocabulary(size_t size, Random& random) {
+    double total = 0;
+    for (size_t i = 0; i < size; i++) {
+      std::string word;
+      size_t length = 3 + random.below(8);
+      for (size_t j = 0; j < length; j++)
+        word.push_back('a' + random.below(26));
+      words.push_back(word);
+      total += 1.0 / (i + 1);
+      cumulative.push_back(total);
+    }
+    for (auto& weight : cumulative)
+      weight /= total;
+  }
+
+  const std::string& pick(Random& random) const {
+    double point = random.uniform();
+    size_t low = 0;
+    size_t high = cumulative.size() - 1;
+    while (low < high) {
+      size_t middle = (low + high) / 2;
+      if (cumulative[middle] < point)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    return words[low];
+  }
+
+ private:
+  std::vector<std::string> words;
+  std::vector<double> cumulative;
+};
+
+/**
+ * Формирует новую строку лога: время, хост, уровень и набор слов.
+ */
+static std::string makeLine(uint64_t number,
+                            Random& random,
+                            const Vocabulary& vocabulary,
+                            const CorpusOptions& options) {
+  char prefix[64];
+  uint64_t seconds = number / 7;
+  snprintf(prefix, sizeof(prefix), "2017-11-%02u %02u:%02u:%02u host%02u %s",
+           (unsigned)(1 + seconds / 86400 % 28),
+           (unsigned)(seconds / 3600 % 24), (unsigned)(seconds / 60 % 60),
+           (unsigned)(seconds % 60), (unsigned)random.below(HOSTS_COUNT),
+           LEVELS[random.below(LEVELS_COUNT)]);
+
+  std::string line(prefix);
+  double length = random.normal(options.lengthMean, options.lengthDeviation);
+  size_t target = length < line.size() + 2 ? line.size() + 2 : (size_t)length;
+  while (line.size() < target) {
+    line.push_back(' ');
+    line += vocabulary.pick(random);
+  }
+  return line;
+}
+
+static bool parseOptions(const std::vector<std::string>& args,
+                         CorpusOptions& options) {
+  for (auto i = args.begin(); i < args.end(); i++) {
+    if ((i + 1) == args.end()) {
+      std::cerr << "Option " << *i << " is not set." << std::endl;
+      return false;
+    }
+    const std::string& value = *++i;
+    if (*(i - 1) == "--size")
+      options.size = std::stoull(value);
+    else if (*(i - 1) == "--seed")
+      options.seed = std::stoull(value);
+    else if (*(i - 1) == "--length-mean")
+      options.lengthMean = std::stod(value);
+    else if (*(i - 1) == "--length-deviation")
+      options.lengthDeviation = std::stod(value);
+    else if (*(i - 1) == "--vocabulary")
+      options.vocabulary = std::stoull(value);
+    else if (*(i - 1) == "--duplicate-rate")
+      options.duplicateRate = std::stod(value);
+    else if (*(i - 1) == "-o")
+      options.output = value;
+    else {
+      std::cerr << "Unknown option: " << *(i - 1) << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, const char* argv[]) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  CorpusOptions options;
+
+  try {
+    if (!parseOptions(args, options))
+      return 1;
+  } catch (const std::logic_error& e) {
+    std::cerr << "Invalid option value." << std::endl;
+    return 1;
+  }
+
+  if (options.vocabulary == 0) {
+    std::cerr << "Vocabulary cannot be empty." << std::endl;
+    return 1;
+  }
+
+  std::ofstream file;
+  if (options.output != "") {
+    file.open(options.output);
+    if (!file.is_open()) {
+      std::cerr << "Cannot open file: \"" << options.output << "\""
+                << std::endl;
+      return 1;
+    }
+  }
+  std::ostream& output = options.output != "" ? file : std::cout;
+
+  Random random(options.seed);
+  Vocabulary vocabulary(options.vocabulary, random);
+  std::vector<std::string> recent;
+  uint64_t written = 0;
+
+  for (uint64_t number = 0; written < options.size; number++) {
+    std::string line;
+    if (!recent.empty() && random.uniform() < options.duplicateRate) {
+      line = recent[random.below(recent.size())];
+    } else {
+      line = makeLine(number, random, vocabulary, options);
+      if (recent.size() < RECENT_LINES)
+        recent.push_back(line);
+      else
+        recent[random.below(RECENT_LINES)] = line;
+    }
+    output << line << '\n';
+    written += line.size() + 1;
+  }
+
+  output.flush();
+  return output ? 0 : 1;
+}
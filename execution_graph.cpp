@@ -0,0 +1,254 @@
+//
+//  execution_graph.cpp
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "execution_graph.h"
+
+namespace wkfw {
+
+size_t ExecutionGraph::addNode(const Worker* worker,
+                               const std::vector<size_t>& inputs) {
+  const size_t position = nodes.size();
+  nodes.push_back(Node{worker, inputs, std::vector<size_t>(), nullptr});
+  for (auto input : inputs)
+    nodes[input].outputs.push_back(position);
+  return position;
+}
+
+size_t ExecutionGraph::addNode(std::shared_ptr<const Worker> worker,
+                               const std::vector<size_t>& inputs) {
+  const size_t position = addNode(worker.get(), inputs);
+  nodes[position].owned = worker;
+  return position;
+}
+
+bool ExecutionGraph::isChain() const {
+  for (size_t i = 0; i < nodes.size(); i++)
+    if (nodes[i].outputs.size() > 1 || nodes[i].inputs.size() > 1 ||
+        (i > 0 && nodes[i].inputs.empty()))
+      return false;
+  return true;
+}
+
+std::vector<std::string> ExecutionGraph::getKeys() const {
+  std::vector<std::string> keys(nodes.size());
+
+  for (size_t i = 0; i < nodes.size(); i++) {
+    const std::string fingerprint = nodes[i].worker->getFingerprint();
+    if (fingerprint == "")
+      continue;
+
+    std::string inputs;
+    bool cacheable = true;
+    for (auto input : nodes[i].inputs) {
+      cacheable = cacheable && keys[input] != "";
+      inputs += keys[input];
+    }
+    if (cacheable)
+      keys[i] = ResultCache::makeKey(inputs, fingerprint);
+  }
+
+  return keys;
+}
+
+/**
+ * Одно исполнение графа.
+ */
+class GraphRun {
+ public:
+  GraphRun(const ExecutionGraph& graph,
+           std::shared_ptr<const ResultCache> cache,
+           std::shared_ptr<MemoryBudget> budget)
+      : graph(graph),
+        cache(cache),
+        arena(std::make_shared<Arena>(budget)),
+        results(graph.size()),
+        pending(graph.size(), 0),
+        consumers(graph.size(), 0),
+        active(graph.size(), true),
+        failed(graph.size(), false),
+        remaining(0) {}
+
+  std::map<size_t, std::string> run() {
+    prepare();
+
+    size_t threads = 1;
+    if (!graph.isChain()) {
+      threads = std::min<size_t>(std::thread::hardware_concurrency(), remaining);
+      threads = std::max<size_t>(threads, 1);
+    }
+
+    // Текущий поток тоже исполняет узлы
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < threads; i++)
+      helpers.push_back(std::thread(&GraphRun::work, this));
+    work();
+    for (auto& helper : helpers)
+      helper.join();
+
+    return errors;
+  }
+
+ private:
+  const ExecutionGraph& graph;
+  std::shared_ptr<const ResultCache> cache;
+  // Арена для строк, созданных блоками за это исполнение
+  std::shared_ptr<Arena> arena;
+  std::vector<std::string> keys;
+  std::vector<WorkerResult> results;
+  // Количество незавершенных входов узла
+  std::vector<size_t> pending;
+  // Количество незавершенных потребителей результата узла
+  std::vector<size_t> consumers;
+  // Не std::vector<bool>: соседние флаги одного слова читаются без
+  // блокировки, пока другой поток записывает свой флаг в finish()
+  std::vector<char> active;
+  std::vector<char> failed;
+  size_t remaining;
+  std::deque<size_t> ready;
+  std::map<size_t, std::string> errors;
+  std::mutex mutex;
+  std::condition_variable condition;
+
+  /**
+   * Восстанавливает результаты из кэша и определяет исполняемые узлы.
+   */
+  void prepare() {
+    if (cache)
+      keys = graph.getKeys();
+
+    // От потребителей к источникам: результат узла нужен, если у него есть
+    // побочные эффекты или он нужен исполняемому потребителю
+    for (size_t i = graph.size(); i-- > 0;) {
+      if (!cache)
+        break;
+
+      bool required = graph.getOutputs(i).empty() || keys[i] == "";
+      for (auto output : graph.getOutputs(i))
+        required = required || active[output];
+
+      // Результат источника - содержимое входного файла, его не кэшируем
+      if (!required || (!graph.getInputs(i).empty() &&
+                        cache->load(keys[i], results[i])))
+        active[i] = false;
+    }
+
+    for (size_t i = 0; i < graph.size(); i++) {
+      if (!active[i])
+        continue;
+      remaining++;
+      for (auto input : graph.getInputs(i)) {
+        if (active[input])
+          pending[i]++;
+        consumers[input]++;
+      }
+      if (pending[i] == 0)
+        ready.push_back(i);
+    }
+  }
+
+  /**
+   * Исполняет готовые узлы, пока не завершатся все.
+   */
+  void work() {
+    while (true) {
+      size_t node;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return !ready.empty() || !remaining; });
+        if (ready.empty())
+          return;
+        node = ready.front();
+        ready.pop_front();
+      }
+
+      // Входы узла завершены и не меняются до его завершения
+      bool skip = false;
+      for (auto input : graph.getInputs(node))
+        skip = skip || failed[input];
+
+      WorkerResult result;
+      bool raised = false;
+      std::string error;
+      if (!skip) {
+        try {
+          result = graph.getWorker(node)->execute(gatherInputs(node));
+          if (cache && keys[node] != "" && !graph.getInputs(node).empty())
+            cache->store(keys[node], result);
+        } catch (const std::exception& e) {
+          raised = true;
+          error = e.what();
+        }
+      }
+
+      finish(node, result, skip || raised, raised, error);
+    }
+  }
+
+  WorkerResult gatherInputs(const size_t node) const {
+    const std::vector<size_t>& inputs = graph.getInputs(node);
+    if (inputs.empty())
+      return WorkerResult().withArena(arena);
+    if (inputs.size() == 1)
+      return results[inputs.front()].withArena(arena);
+
+    // Слияние: тексты входов объединяются в порядке объявления, строки
+    // разных столбцов копируются в общий столбец
+    TextBuilder merged(arena);
+    for (auto input : inputs)
+      merged.append(results[input].getValue());
+    return WorkerResult(merged.build()).withArena(arena);
+  }
+
+  /**
+   * Сохраняет результат узла и делает готовыми его потребителей.
+   *
+   * @param failure Узел не исполнен из-за ошибки в нем или в его входах.
+   * @param raised Ошибка возникла в самом узле.
+   */
+  void finish(const size_t node,
+              const WorkerResult& result,
+              const bool failure,
+              const bool raised,
+              const std::string& error) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      failed[node] = failure;
+      if (raised)
+        errors[node] = error;
+      if (consumers[node] > 0)
+        results[node] = result;
+
+      for (auto input : graph.getInputs(node))
+        if (--consumers[input] == 0)
+          results[input] = WorkerResult();
+
+      for (auto output : graph.getOutputs(node))
+        if (active[output] && --pending[output] == 0)
+          ready.push_back(output);
+
+      remaining--;
+    }
+    condition.notify_all();
+  }
+};
+
+std::map<size_t, std::string> ExecutionGraph::execute(
+    std::shared_ptr<const ResultCache> cache,
+    std::shared_ptr<MemoryBudget> budget) const {
+  GraphRun run(*this, cache, budget);
+  return run.run();
+}
+
+}  // namespace wkfw
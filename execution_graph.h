@@ -0,0 +1,115 @@
+//
+//  execution_graph.h
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef EXECUTION_GRAPH_H_
+#define EXECUTION_GRAPH_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "result_cache.h"
+#include "worker.h"
+
+namespace wkfw {
+
+/**
+ * Граф исполнения: обработчики блоков и связи между ними.
+ *
+ * Узлы добавляются в топологическом порядке: входы узла должны быть
+ * добавлены раньше него. Результаты нескольких входов объединяются
+ * в указанном порядке.
+ */
+class ExecutionGraph {
+ public:
+  /**
+   * Добавляет узел.
+   *
+   * @param worker Обработчик.
+   * @param inputs Позиции узлов, результаты которых поступают на вход.
+   *
+   * @return Позиция нового узла.
+   */
+  size_t addNode(const Worker* worker, const std::vector<size_t>& inputs);
+
+  /**
+   * Добавляет узел, обработчиком которого владеет граф,
+   * например созданный при оптимизации.
+   */
+  size_t addNode(std::shared_ptr<const Worker> worker,
+                 const std::vector<size_t>& inputs);
+
+  /**
+   * @return Количество узлов.
+   */
+  size_t size() const { return nodes.size(); }
+
+  const Worker* getWorker(const size_t node) const {
+    return nodes[node].worker;
+  }
+
+  /**
+   * @return Обработчик узла, если им владеет граф, иначе nullptr.
+   */
+  std::shared_ptr<const Worker> getOwnedWorker(const size_t node) const {
+    return nodes[node].owned;
+  }
+
+  const std::vector<size_t>& getInputs(const size_t node) const {
+    return nodes[node].inputs;
+  }
+
+  const std::vector<size_t>& getOutputs(const size_t node) const {
+    return nodes[node].outputs;
+  }
+
+  /**
+   * @return true, если граф - одна цепочка без ветвлений и слияний.
+   */
+  bool isChain() const;
+
+  /**
+   * Вычисляет ключи результатов узлов для кэша (см. ResultCache).
+   *
+   * @return Ключи по позициям узлов. Пустой ключ - результат узла
+   * не может кэшироваться.
+   */
+  std::vector<std::string> getKeys() const;
+
+  /**
+   * Исполняет граф. Независимые ветви исполняются параллельно, результат
+   * узла передается всем его потребителям без копирования и освобождается,
+   * как только все они завершатся. Ошибка в узле прерывает только
+   * зависящие от него узлы.
+   *
+   * @param cache Кэш результатов или nullptr. При наличии кэша узлы,
+   * результаты которых не нужны для восстановленных из кэша, не исполняются.
+   * @param budget Учет памяти исполнения или nullptr. Узел, превысивший
+   * ограничение, завершается ошибкой.
+   *
+   * @return Описания ошибок по позициям узлов, в которых они возникли.
+   */
+  std::map<size_t, std::string> execute(
+      std::shared_ptr<const ResultCache> cache = nullptr,
+      std::shared_ptr<MemoryBudget> budget = nullptr) const;
+
+ private:
+  struct Node {
+    const Worker* worker;
+    std::vector<size_t> inputs;
+    std::vector<size_t> outputs;
+    std::shared_ptr<const Worker> owned;
+  };
+
+  std::vector<Node> nodes;
+};
+
+}  // namespace wkfw
+
+#endif /* EXECUTION_GRAPH_H_ */
@@ -0,0 +1,58 @@
+//
+//  fields.cpp
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "fields.h"
+
+namespace wkfw {
+
+static bool isSeparator(const char symbol) {
+  return symbol == ' ' || symbol == '\t';
+}
+
+FieldIndex::FieldIndex(const Text& text) {
+  first.reserve(text.size() + 1);
+
+  for (auto const& line : text) {
+    first.push_back(spans.size());
+    const size_t size = line.size;
+    size_t position = 0;
+    while (true) {
+      while (position < size && isSeparator(line.data[position]))
+        position++;
+      if (position == size)
+        break;
+      const size_t begin = position;
+      while (position < size && !isSeparator(line.data[position]))
+        position++;
+      spans.push_back(FieldSpan{(uint32_t)begin, (uint32_t)position});
+    }
+  }
+  first.push_back(spans.size());
+}
+
+FieldSpan FieldIndex::findField(const char* line,
+                                const size_t size,
+                                const size_t field) {
+  size_t position = 0;
+
+  for (size_t current = 1; field > 0; current++) {
+    while (position < size && isSeparator(line[position]))
+      position++;
+    if (position == size)
+      break;
+    const size_t begin = position;
+    while (position < size && !isSeparator(line[position]))
+      position++;
+    if (current == field)
+      return FieldSpan{(uint32_t)begin, (uint32_t)position};
+  }
+
+  return FieldSpan{0, 0};
+}
+
+}  // namespace wkfw
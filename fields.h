@@ -0,0 +1,70 @@
+//
+//  fields.h
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef FIELDS_H_
+#define FIELDS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "text.h"
+
+namespace wkfw {
+
+/**
+ * Поле строки: смещения его начала и конца в строке.
+ */
+struct FieldSpan {
+  uint32_t begin;
+  uint32_t end;
+
+  uint32_t size() const { return end - begin; }
+};
+
+/**
+ * Индекс полей текста: границы полей всех строк, вычисленные за один проход.
+ * Поля разделяются последовательностями пробелов и табуляций
+ * и нумеруются с 1.
+ */
+class FieldIndex {
+ public:
+  explicit FieldIndex(const Text& text);
+
+  /**
+   * @return Количество полей в строке.
+   */
+  size_t getCount(const size_t line) const {
+    return first[line + 1] - first[line];
+  }
+
+  /**
+   * @return Поле строки или пустое поле, если в строке меньше полей.
+   */
+  FieldSpan getField(const size_t line, const size_t field) const {
+    if (field == 0 || field > getCount(line))
+      return FieldSpan{0, 0};
+    return spans[first[line] + field - 1];
+  }
+
+  /**
+   * Находит поле в отдельной строке без построения индекса.
+   */
+  static FieldSpan findField(const char* line,
+                             const size_t size,
+                             const size_t field);
+
+ private:
+  std::vector<FieldSpan> spans;
+  // Позиция первого поля строки в spans, для последней строки - spans.size()
+  std::vector<size_t> first;
+};
+
+}  // namespace wkfw
+
+#endif /* FIELDS_H_ */
@@ -0,0 +1,55 @@
+//
+//  hash.h
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace wkfw {
+
+/**
+ * Перемешивание битов 64-битного числа (финализатор MurmurHash3).
+ */
+inline uint64_t mixBits(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xFF51AFD7ED558CCDULL;
+  value ^= value >> 33;
+  value *= 0xC4CEB9FE1A85EC53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+/**
+ * Быстрый некриптографический хэш строки, обрабатывающий по 8 байт за шаг.
+ */
+inline uint64_t hashBytes(const char* data, size_t size) {
+  uint64_t hash = 0x9E3779B97F4A7C15ULL ^ (size * 0xC2B2AE3D27D4EB4FULL);
+
+  while (size >= sizeof(uint64_t)) {
+    uint64_t chunk;
+    memcpy(&chunk, data, sizeof(chunk));
+    hash = (hash ^ mixBits(chunk)) * 0x9FB21C651E98DF25ULL;
+    data += sizeof(chunk);
+    size -= sizeof(chunk);
+  }
+
+  uint64_t tail = 0;
+  memcpy(&tail, data, size);
+  return mixBits(hash ^ tail);
+}
+
+inline uint64_t hashBytes(const std::string& data) {
+  return hashBytes(data.data(), data.size());
+}
+
+}  // namespace wkfw
+
+#endif /* HASH_H_ */
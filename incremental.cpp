@@ -0,0 +1,180 @@
+//
+//  incremental.cpp
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include "incremental.h"
+#include "result_cache.h"
+#include "streaming.h"
+#include "workers.h"
+
+namespace wkfw {
+
+static const char STATE_MAGIC[] = "WKFWINC2";
+
+// Размер начала входного файла, по которому обнаруживается его замена
+static const uint64_t HEAD_SIZE = 4096;
+
+bool IncrementalState::load(const std::string& filename) {
+  std::ifstream input(filename, std::ios::binary);
+  std::string magic;
+  std::string offsetLine;
+  std::string outputLine;
+  std::string sortedLine;
+
+  if (!std::getline(input, magic) || magic != STATE_MAGIC ||
+      !std::getline(input, workflowKey) || !std::getline(input, offsetLine) ||
+      !std::getline(input, headKey) || !std::getline(input, outputLine) ||
+      !std::getline(input, sortedLine))
+    return false;
+
+  try {
+    offset = std::stoull(offsetLine);
+    outputLength = std::stoull(outputLine);
+  } catch (const std::logic_error& e) {
+    return false;
+  }
+
+  sorted = sortedLine == "1";
+  return !sorted || readResult(input, sortedText);
+}
+
+bool IncrementalState::save(const std::string& filename) const {
+  const std::string temporary = filename + ".tmp";
+  std::ofstream output(temporary, std::ios::binary);
+
+  output << STATE_MAGIC << "\n"
+         << workflowKey << "\n"
+         << offset << "\n"
+         << headKey << "\n"
+         << outputLength << "\n"
+         << (sorted ? "1" : "0") << "\n";
+  if (sorted)
+    writeResult(output, sortedText);
+  output.close();
+
+  if (!output || rename(temporary.c_str(), filename.c_str()) != 0) {
+    remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @return Хэш первых size байт файла.
+ */
+static std::string hashHead(const std::string& filename, uint64_t size) {
+  std::ifstream input(filename, std::ios::binary);
+  std::string head(size, '\0');
+  input.read(&head[0], size);
+  head.resize(input.gcount());
+  return ResultCache::makeKey("", head);
+}
+
+static uint64_t fileSize(const std::string& filename) {
+  struct stat info;
+  return stat(filename.c_str(), &info) == 0 ? info.st_size : 0;
+}
+
+/**
+ * Возвращает выходной файл к длине после предыдущего запуска.
+ *
+ * @return false, если файл короче: он изменен не Workflow.
+ */
+static bool restoreOutput(const std::string& filename, const uint64_t length) {
+  if (filename == workers::STANDARD_STREAM)
+    return true;
+  const uint64_t size = fileSize(filename);
+  if (size < length)
+    return false;
+  return size == length || truncate(filename.c_str(), length) == 0;
+}
+
+void executeIncremental(const std::vector<const Worker*>& chain,
+                        const std::string& stateFile) throw(
+    WorkerExecuteException) {
+  // Разбираем конвейер на части до и после сортировки
+  LinearChain parts;
+  const size_t failed = parts.parse(chain);
+  const workers::ReadFile* reader = parts.reader;
+  if (reader == nullptr)
+    throw WorkerExecuteException(
+        "Incremental mode requires reading from file.");
+  if (!reader->isSingleFile() ||
+      reader->getFilename() == workers::STANDARD_STREAM)
+    throw WorkerExecuteException(
+        "Incremental mode requires a single input file.");
+  if (failed < chain.size())
+    throw WorkerExecuteException("Instruction " +
+                                 std::to_string(chain[failed]->getId()) +
+                                 " cannot be executed incrementally.");
+
+  const std::vector<const workers::LineWorker*>& prefix = parts.prefix;
+  const std::vector<const workers::LineWorker*>& suffix = parts.suffix;
+  const workers::Sort* sort = parts.sort;
+  const workers::WriteFile* writer = parts.writer;
+  if (writer == nullptr)
+    throw WorkerExecuteException(
+        "Incremental mode requires writing to file.");
+
+  std::string key = ResultCache::makeKey("", reader->getFilename());
+  for (size_t i = 1; i + 1 < chain.size(); i++)
+    key = ResultCache::makeKey(key, chain[i]->getFingerprint());
+  key = ResultCache::makeKey(key, writer->getFilename());
+
+  // Продолжаем с сохраненного места, только если файл лишь дописывался
+  IncrementalState state;
+  bool resume = state.load(stateFile) && state.workflowKey == key &&
+                fileSize(reader->getFilename()) >= state.offset &&
+                state.headKey == hashHead(reader->getFilename(),
+                                          std::min(state.offset, HEAD_SIZE));
+  if (resume && sort == nullptr)
+    resume = restoreOutput(writer->getFilename(), state.outputLength);
+  if (!resume) {
+    state = IncrementalState();
+    state.workflowKey = key;
+  }
+
+  uint64_t end;
+  WorkerResult tail = reader->readFrom(state.offset, end);
+  Text lines = workers::applyLineWorkers(prefix, tail.getValue(), nullptr);
+
+  if (sort != nullptr) {
+    const Text sortedTail =
+        sort->execute(WorkerResult(std::move(lines))).getValue();
+    Text merged;
+    if (state.sorted) {
+      merged = sort->merge(state.sortedText.getValue(), sortedTail);
+    } else {
+      merged = sortedTail;
+    }
+    writer->execute(
+        WorkerResult(workers::applyLineWorkers(suffix, merged, nullptr)));
+    state.sorted = true;
+    state.sortedText = WorkerResult(std::move(merged));
+  } else if (resume) {
+    writer->append(WorkerResult(std::move(lines)));
+  } else {
+    writer->execute(WorkerResult(std::move(lines)));
+  }
+
+  state.offset = end;
+  state.outputLength = fileSize(writer->getFilename());
+  state.headKey =
+      hashHead(reader->getFilename(), std::min(state.offset, HEAD_SIZE));
+  if (!state.save(stateFile))
+    throw WorkerExecuteException("Cannot write incremental state to file \"" +
+                                 stateFile + "\"");
+}
+
+}  // namespace wkfw
@@ -0,0 +1,70 @@
+//
+//  incremental.h
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef INCREMENTAL_H_
+#define INCREMENTAL_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "worker.h"
+
+namespace wkfw {
+
+/**
+ * Состояние инкрементального исполнения, сохраняемое между запусками.
+ */
+struct IncrementalState {
+  // Ключ схемы: входной и выходной файлы и отпечатки блоков
+  std::string workflowKey;
+  // Количество обработанных байт входного файла
+  uint64_t offset = 0;
+  // Хэш начала входного файла, для обнаружения его замены
+  std::string headKey;
+  // Длина выходного файла после запуска. Если запуск прервался между
+  // дописыванием результата и сохранением состояния, лишние строки
+  // отрезаются
+  uint64_t outputLength = 0;
+  // Накопленный результат сортировки, если она есть в схеме
+  bool sorted = false;
+  WorkerResult sortedText;
+
+  /**
+   * @return true, если состояние прочитано и корректно.
+   */
+  bool load(const std::string& filename);
+
+  /**
+   * @return true, если состояние записано.
+   */
+  bool save(const std::string& filename) const;
+};
+
+/**
+ * Исполняет конвейер, обрабатывая только строки, дописанные во входной файл
+ * с момента предыдущего запуска.
+ *
+ * Поддерживаются конвейеры вида
+ * readfile -> построчные блоки -> [sort -> построчные блоки] -> writefile.
+ * Без сортировки новые строки дописываются в выходной файл, с сортировкой -
+ * сливаются с сохраненным отсортированным результатом, поэтому запуск
+ * со схемой с сортировкой переписывает результат и состояние целиком.
+ * Если входной файл был заменен или изменилась схема, обработка
+ * начинается сначала.
+ *
+ * @param chain Конвейер, начинающийся с чтения и завершающийся записью файла.
+ * @param stateFile Файл состояния.
+ */
+void executeIncremental(const std::vector<const Worker*>& chain,
+                        const std::string& stateFile) throw(
+    WorkerExecuteException);
+
+}  // namespace wkfw
+
+#endif /* INCREMENTAL_H_ */
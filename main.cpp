@@ -6,55 +6,223 @@
 //  Copyright © 2017 Кирилл. All rights reserved.
 //
 
+#include <algorithm>
+#include <cctype>
+#include <csignal>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "workflow.h"
+#include "workflow_batch.h"
+#include "workflow_server.h"
+
+static wkfw::WorkflowServer* runningServer = nullptr;
+
+static void stopServer(int) {
+  if (runningServer != nullptr)
+    runningServer->stop();
+}
+
+/**
+ * Запускает Workflow в режиме долгоживущего процесса.
+ */
+static int runDaemon(const std::string& socketPath,
+                     std::shared_ptr<const wkfw::ResultCache> resultCache,
+                     std::shared_ptr<wkfw::MemoryBudget> memoryBudget) {
+  try {
+    wkfw::WorkflowServer server(socketPath);
+    server.setResultCache(resultCache);
+    server.setMemoryBudget(memoryBudget);
+    runningServer = &server;
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    server.run();
+    runningServer = nullptr;
+  } catch (const wkfw::ServerException& e) {
+    std::cerr << "ServerException: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Разбирает объем памяти: число байт с необязательным суффиксом
+ * K, M или G (степени 1024).
+ *
+ * @return false, если объем задан неверно.
+ */
+static bool parseMemorySize(const std::string& text, size_t& size) {
+  char* end;
+  const unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+  if (end == text.c_str() || !isdigit((unsigned char)text[0]))
+    return false;
+
+  const std::string suffix = end;
+  size_t shift = 0;
+  if (suffix == "K" || suffix == "k")
+    shift = 10;
+  else if (suffix == "M" || suffix == "m")
+    shift = 20;
+  else if (suffix == "G" || suffix == "g")
+    shift = 30;
+  else if (suffix != "")
+    return false;
+
+  size = (size_t)value << shift;
+  return size > 0 && (size >> shift) == value;
+}
+
+/**
+ * Задает Workflow входные файлы, если их несколько или задан способ
+ * объединения их строк.
+ */
+static void setInputFiles(wkfw::Workflow& workflow,
+                          const std::vector<std::string>& inputFilenames,
+                          const workers::ReadFile::Mode inputMode) {
+  if (inputFilenames.size() > 1 ||
+      (!inputFilenames.empty() &&
+       inputMode != workers::ReadFile::Mode::CONCAT))
+    workflow.setInputFiles(inputFilenames, inputMode);
+}
+
+/**
+ * Совместно исполняет несколько схем над общими входными файлами.
+ */
+static int runBatch(const std::vector<std::string>& workflowInputs,
+                    const std::vector<std::string>& inputFilenames,
+                    const workers::ReadFile::Mode inputMode,
+                    std::shared_ptr<const wkfw::ResultCache> resultCache,
+                    std::shared_ptr<wkfw::MemoryBudget> memoryBudget) {
+  wkfw::WorkflowBatch batch;
+  batch.setResultCache(resultCache);
+  batch.setMemoryBudget(memoryBudget);
+
+  try {
+    for (auto const& workflowInput : workflowInputs) {
+      std::ifstream file(workflowInput);
+      if (!file.is_open()) {
+        std::cerr << "Cannot open file: \"" << workflowInput << "\""
+                  << std::endl;
+        return 1;
+      }
+      auto workflow = std::make_shared<wkfw::Workflow>(
+          file, inputFilenames.empty() ? "" : inputFilenames.front(), "");
+      setInputFiles(*workflow, inputFilenames, inputMode);
+      batch.add(workflowInput, workflow);
+    }
+    batch.execute();
+  } catch (const wkfw::InvalidWorkflowException& e) {
+    std::cerr << "InvalidWorkflowException: " << e.what() << std::endl;
+  } catch (const wkfw::WorkerExecuteException& e) {
+    std::cerr << "WorkerExecuteException: " << e.what() << std::endl;
+  }
+
+  return 0;
+}
 
 int main(int argc, const char* argv[]) {
+  std::ios::sync_with_stdio(false);
   std::vector<std::string> args(argv + 1, argv + argc);
-  std::string inputFilename;
+  std::vector<std::string> inputFilenames;
+  workers::ReadFile::Mode inputMode = workers::ReadFile::Mode::CONCAT;
   std::string outputFilename;
-  std::string workflowInput;
+  std::vector<std::string> workflowInputs;
+  std::string daemonSocket;
+  std::string cacheDirectory;
+  std::string incrementalState;
+  size_t memoryLimit = 0;
 
   // Разбор аргументов командной строки
   for (auto i = args.begin(); i < args.end(); i++) {
+    // Аргумент "-" - стандартный ввод или вывод
+    const bool hasArgument =
+        (i + 1) != args.end() &&
+        ((*(i + 1))[0] != '-' || *(i + 1) == workers::STANDARD_STREAM);
+
     if ((*i)[0] != '-') {  // Не название опции
-      if (workflowInput != "") {
-        std::cerr << "To many workflow input files." << std::endl;
+      workflowInputs.push_back(*i);
+    } else if ((*i) == "--merge" || (*i) == "--interleave") {
+      if (inputMode != workers::ReadFile::Mode::CONCAT) {
+        std::cerr << "Several input modes are set." << std::endl;
         return 1;
       }
-      workflowInput = *i;
-    } else if ((i + 1) == args.end() ||
-               (*(i + 1))[0] == '-') {  // Опции с аргументами
+      inputMode = (*i) == "--merge" ? workers::ReadFile::Mode::MERGE
+                                    : workers::ReadFile::Mode::INTERLEAVE;
+    } else if (!hasArgument) {  // Опции с аргументами
       std::cerr << "Option " << *i << " is not set." << std::endl;
       return 1;
     } else if ((*i) == "-i") {
-      if (inputFilename != "") {
-        std::cerr << "To many input files." << std::endl;
-        return 1;
-      }
-      inputFilename = *++i;
+      inputFilenames.push_back(*++i);
     } else if ((*i) == "-o") {
       if (outputFilename != "") {
         std::cerr << "To many output files." << std::endl;
         return 1;
       }
       outputFilename = *++i;
+    } else if ((*i) == "--daemon") {
+      daemonSocket = *++i;
+    } else if ((*i) == "--cache") {
+      cacheDirectory = *++i;
+    } else if ((*i) == "--incremental") {
+      incrementalState = *++i;
+    } else if ((*i) == "--memory-limit") {
+      if (!parseMemorySize(*++i, memoryLimit)) {
+        std::cerr << "Invalid memory limit: " << *i << std::endl;
+        return 1;
+      }
     } else {
       std::cerr << "Unknown option: " << *i << std::endl;
       return 1;
     }
   }
 
+  std::shared_ptr<const wkfw::ResultCache> resultCache;
+  if (cacheDirectory != "")
+    resultCache = std::make_shared<wkfw::ResultCache>(cacheDirectory);
+
+  // Один учет памяти на весь процесс
+  std::shared_ptr<wkfw::MemoryBudget> memoryBudget;
+  if (memoryLimit != 0)
+    memoryBudget = std::make_shared<wkfw::MemoryBudget>(memoryLimit);
+
+  if (daemonSocket != "") {
+    if (!workflowInputs.empty() || !inputFilenames.empty() ||
+        outputFilename != "" || incrementalState != "") {
+      std::cerr << "Daemon mode accepts workflows only via socket."
+                << std::endl;
+      return 1;
+    }
+    return runDaemon(daemonSocket, resultCache, memoryBudget);
+  }
+
   // Проверка наличия параметров
-  if (workflowInput == "") {
+  if (workflowInputs.empty()) {
     std::cerr << "No workflow input file." << std::endl;
     return 1;
   }
 
+  if (workflowInputs.size() > 1) {
+    if (outputFilename != "" || incrementalState != "") {
+      std::cerr << "Several workflows cannot share output or incremental "
+                   "options."
+                << std::endl;
+      return 1;
+    }
+    if (std::find(inputFilenames.begin(), inputFilenames.end(),
+                  workers::STANDARD_STREAM) != inputFilenames.end()) {
+      std::cerr << "Several workflows cannot share standard input."
+                << std::endl;
+      return 1;
+    }
+    return runBatch(workflowInputs, inputFilenames, inputMode, resultCache,
+                    memoryBudget);
+  }
+
+  const std::string& workflowInput = workflowInputs.front();
   std::ifstream file(workflowInput);
   if (!file.is_open()) {
     std::cerr << "Cannot open file: \"" << workflowInput << "\"" << std::endl;
@@ -62,7 +230,13 @@ int main(int argc, const char* argv[]) {
   }
 
   try {
-    wkfw::Workflow workflow(file, inputFilename, outputFilename);
+    wkfw::Workflow workflow(
+        file, inputFilenames.empty() ? "" : inputFilenames.front(),
+        outputFilename);
+    setInputFiles(workflow, inputFilenames, inputMode);
+    workflow.setResultCache(resultCache);
+    workflow.setIncrementalState(incrementalState);
+    workflow.setMemoryBudget(memoryBudget);
     workflow.execute();
   } catch (const wkfw::InvalidWorkflowException& e) {
     std::cerr << "InvalidWorkflowException: " << e.what() << std::endl;
@@ -66,8 +66,13 @@ workflow:
 ;
 
 instructions:
-            NUMBER { driver.receiveInstruction($1); }
-            | instructions ARROW NUMBER { driver.receiveInstruction($3); }
+            chain
+            | instructions chain
+;
+
+chain:
+      NUMBER { driver.receiveChain($1); }
+      | chain ARROW NUMBER { driver.receiveInstruction($3); }
 ;
 
 description:
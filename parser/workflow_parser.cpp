@@ -6,6 +6,8 @@
 //  Copyright © 2017 Кирилл. All rights reserved.
 //
 
+#include <algorithm>
+#include <set>
 #include <sstream>
 
 #include "workers.h"
@@ -22,52 +24,141 @@ WorkflowParser::WorkflowParser(std::istream& stream) throw(
 
   if (parser.parse())
     throw InvalidWorkflowException("Parse error: " + errorMsg);
-}
 
-const Worker* WorkflowParser::getWorkerById(const size_t ident) const {
-  auto found = description.find(ident);
-  return found == description.end() ? nullptr : found->second;
+  sortInstructions();
+  buildPlan();
 }
 
-WorkflowParser::WorkflowParser() {
-  for (auto const& worker : description)
-    delete worker.second;
+const Worker* WorkflowParser::getWorkerById(const size_t ident) const {
+  for (auto const& step : steps)
+    if (step.worker->getId() == ident)
+      return step.worker.get();
+  for (auto const& worker : unused)
+    if (worker->getId() == ident)
+      return worker.get();
+  return nullptr;
 }
 
 const Worker* WorkflowParser::nextInstruction() {
-  return position < instructions.size()
-             ? getWorkerById(instructions[position++])
-             : nullptr;
+  return position < steps.size() ? steps[position++].worker.get() : nullptr;
 }
 
 void WorkflowParser::resetSteps() {
   position = 0;
 }
 
+size_t WorkflowParser::getInstructionsCount() const {
+  return steps.size();
+}
+
+const Worker* WorkflowParser::getInstruction(const size_t index) const {
+  return index < steps.size() ? steps[index].worker.get() : nullptr;
+}
+
 void WorkflowParser::receiveCommand(const wkfw::WorkflowCommand& cmd) throw(
     wkfw::InvalidWorkflowException) {
   if (description.find(cmd.instructionNumber) != description.end())
     throw InvalidWorkflowException(
         "Repeating instruction numbers in description block.");
 
-  const Worker* worker =
-      workers::constructWorker(cmd.instructionNumber, cmd.name, cmd.args);
-  if (worker == nullptr) {
+  std::unique_ptr<const Worker> worker(
+      workers::constructWorker(cmd.instructionNumber, cmd.name, cmd.args));
+  if (!worker) {
     std::ostringstream str;
     str << "Cannot find instruction " << cmd.instructionNumber << " = ";
     str << "\"" << cmd.name << "\" with " << cmd.args.size() << " args.";
     throw InvalidWorkflowException(str.str());
   }
 
-  description[cmd.instructionNumber] = worker;
+  description[cmd.instructionNumber] = std::move(worker);
 }
 
-void WorkflowParser::receiveInstruction(const size_t num) {
+std::vector<size_t> WorkflowParser::getInputs(const size_t ident) const {
+  std::vector<size_t> sources;
+  for (auto const& step : steps) {
+    if (step.worker->getId() != ident)
+      continue;
+    for (auto input : step.inputs)
+      sources.push_back(steps[input].worker->getId());
+  }
+  return sources;
+}
+
+void WorkflowParser::receiveChain(const size_t num) {
   if (description.find(num) == description.end())
     throw InvalidWorkflowException("Unknown instruction number: " +
                                    std::to_string(num));
 
-  instructions.push_back(num);
+  if (inputs.find(num) == inputs.end()) {
+    inputs[num];
+    instructions.push_back(num);
+  }
+  lastInstruction = num;
+}
+
+void WorkflowParser::receiveInstruction(const size_t num) {
+  const size_t previous = lastInstruction;
+  receiveChain(num);
+
+  // Повтор уже объявленной связи - общий префикс нескольких цепочек
+  std::vector<size_t>& sources = inputs[num];
+  if (std::find(sources.begin(), sources.end(), previous) ==
+      sources.end())
+    sources.push_back(previous);
+}
+
+void WorkflowParser::sortInstructions() throw(InvalidWorkflowException) {
+  // Алгоритм Кана; при равенстве сохраняется порядок объявления
+  std::map<size_t, size_t> pending;
+  std::map<size_t, std::vector<size_t>> outputs;
+  for (auto num : instructions) {
+    pending[num] = inputs[num].size();
+    for (auto source : inputs[num])
+      outputs[source].push_back(num);
+  }
+
+  std::vector<size_t> sorted;
+  std::set<size_t> ready;
+  std::map<size_t, size_t> declared;
+  for (size_t i = 0; i < instructions.size(); i++) {
+    declared[instructions[i]] = i;
+    if (pending[instructions[i]] == 0)
+      ready.insert(i);
+  }
+
+  while (!ready.empty()) {
+    size_t num = instructions[*ready.begin()];
+    ready.erase(ready.begin());
+    sorted.push_back(num);
+    for (auto next : outputs[num])
+      if (--pending[next] == 0)
+        ready.insert(declared[next]);
+  }
+
+  if (sorted.size() != instructions.size())
+    throw InvalidWorkflowException("Instructions form a cycle.");
+
+  instructions = sorted;
+}
+
+void WorkflowParser::buildPlan() {
+  std::map<size_t, size_t> positions;
+  steps.reserve(instructions.size());
+  for (auto num : instructions) {
+    Step step;
+    step.worker = std::move(description[num]);
+    for (auto source : inputs[num])
+      step.inputs.push_back(positions[source]);
+    positions[num] = steps.size();
+    steps.push_back(std::move(step));
+  }
+
+  for (auto& worker : description)
+    if (worker.second)
+      unused.push_back(std::move(worker.second));
+  description.clear();
+  std::vector<size_t>().swap(instructions);
+  inputs.clear();
 }
 
 void WorkflowParser::receiveError(const std::string& msg) throw(
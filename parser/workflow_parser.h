@@ -11,6 +11,7 @@
 
 #include <exception>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -37,13 +38,29 @@ class InvalidWorkflowException : public std::exception {
 
 /**
  * Разбирает, проверяет на валидность и хранит описание Workflow.
+ *
+ * Блок исполнения состоит из одной или нескольких цепочек. Каждый номер
+ * инструкции - узел графа, поэтому цепочки, проходящие через одни и те же
+ * номера, образуют ветвления и слияния. Граф не должен содержать циклов.
+ *
+ * После разбора блок исполнения собирается в план - массив шагов в порядке
+ * топологической сортировки. Шаги владеют обработчиками и хранят позиции
+ * своих входов, поэтому обход плана не ищет инструкции по номерам,
+ * а одно описание можно исполнять многократно (см. resetSteps()).
+ * Обработчики - объекты разных типов и размеров, поэтому каждый размещен
+ * отдельно, а массив шагов хранит указатели на них. Таблицы номеров,
+ * нужные только при разборе, освобождаются после сборки плана.
  */
 class WorkflowParser {
  public:
   WorkflowParser(std::istream& stream) throw(InvalidWorkflowException);
 
+  WorkflowParser(const WorkflowParser&) = delete;
+  WorkflowParser& operator=(const WorkflowParser&) = delete;
+
   /**
-   * Получает обработчик по его уникальному номеру.
+   * Получает обработчик по его уникальному номеру перебором плана
+   * и обработчиков вне блока исполнения.
    *
    * @param ident Уникальный номер обработчика.
    *
@@ -53,7 +70,8 @@ class WorkflowParser {
   const Worker* getWorkerById(const size_t ident) const;
 
   /**
-   * @return Следующая инструкция для исполнения Workflow.
+   * @return Следующая инструкция для исполнения Workflow
+   * (в порядке топологической сортировки графа).
    */
   const Worker* nextInstruction();
 
@@ -62,14 +80,63 @@ class WorkflowParser {
    */
   void resetSteps();
 
-  WorkflowParser();
+  /**
+   * @return Количество инструкций в блоке исполнения.
+   */
+  size_t getInstructionsCount() const;
+
+  /**
+   * Получает инструкцию по ее позиции в блоке исполнения.
+   * В отличие от nextInstruction() не меняет состояние, поэтому одно
+   * описание может исполняться одновременно из нескольких потоков.
+   *
+   * @param index Позиция инструкции.
+   *
+   * @return Обработчик инструкции или nullptr, если позиция за пределами.
+   */
+  const Worker* getInstruction(const size_t index) const;
+
+  /**
+   * Получает номера инструкций, результаты которых поступают на вход
+   * заданной, в порядке их объявления. Инструкция ищется перебором плана.
+   *
+   * @param ident Уникальный номер инструкции.
+   */
+  std::vector<size_t> getInputs(const size_t ident) const;
+
+  /**
+   * Получает позиции инструкций, результаты которых поступают на вход
+   * инструкции на позиции index, в порядке их объявления.
+   *
+   * @param index Позиция инструкции, меньше getInstructionsCount().
+   */
+  const std::vector<size_t>& getInstructionInputs(const size_t index) const {
+    return steps[index].inputs;
+  }
 
   friend class FlexWorkflowLexer;
   friend class BisonWorkflowParser;
 
  private:
-  std::map<size_t, const Worker*> description;
+  /**
+   * Шаг плана: обработчик инструкции и позиции шагов ее входов.
+   */
+  struct Step {
+    std::unique_ptr<const Worker> worker;
+    std::vector<size_t> inputs;
+  };
+
+  // План исполнения
+  std::vector<Step> steps;
+  // Обработчики, не вошедшие в блок исполнения
+  std::vector<std::unique_ptr<const Worker>> unused;
+  // Состояние разбора, до сборки плана: обработчики блока описания,
+  // инструкции в порядке объявления (после сортировки - топологическом)
+  // и их входы
+  std::map<size_t, std::unique_ptr<const Worker>> description;
   std::vector<size_t> instructions;
+  std::map<size_t, std::vector<size_t>> inputs;
+  size_t lastInstruction = 0;
   size_t position = 0;
   std::string errorMsg;
 
@@ -81,11 +148,27 @@ class WorkflowParser {
   void receiveCommand(const WorkflowCommand& cmd) throw(
       InvalidWorkflowException);
 
+  /**
+   * Запоминает первую инструкцию новой цепочки.
+   */
+  void receiveChain(const size_t num);
+
   /**
    * Запоминает инструкцию/
    */
   void receiveInstruction(const size_t num);
 
+  /**
+   * Упорядочивает инструкции топологически и проверяет отсутствие циклов.
+   */
+  void sortInstructions() throw(InvalidWorkflowException);
+
+  /**
+   * Собирает план из упорядоченных инструкций и освобождает состояние
+   * разбора.
+   */
+  void buildPlan();
+
   /**
    * Бросает исключение из парсера.
    */
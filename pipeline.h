@@ -0,0 +1,297 @@
+//
+//  pipeline.h
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "fields.h"
+#include "workers.h"
+
+/**
+ * Этапы конвейера, типы которых известны при компиляции (см. wkfw::pipeline).
+ * Построчный этап - функция над строкой, которую компилятор встраивает
+ * в общий цикл по строкам. Остальные этапы обрабатывают текст целиком
+ * обработчиками блоков.
+ */
+namespace stages {
+
+/**
+ * Начало конвейера: возвращает текст.
+ */
+struct Source {};
+
+/**
+ * Построчный этап: bool operator()(wkfw::Line& line) оставляет строку,
+ * отбрасывает ее (false) или заменяет ссылкой на свой буфер.
+ */
+struct LineStage {};
+
+/**
+ * Этап над всем текстом: wkfw::Text operator()(const wkfw::Text& text).
+ */
+struct TextStage {};
+
+/**
+ * Завершение конвейера: принимает текст.
+ */
+struct Sink {};
+
+/**
+ * Чтение файлов, как readfile.
+ */
+class ReadFile : public Source {
+ public:
+  explicit ReadFile(const std::string& filename) : reader(0, filename) {}
+
+  ReadFile(const std::vector<std::string>& patterns,
+           const workers::ReadFile::Mode mode =
+               workers::ReadFile::Mode::CONCAT)
+      : reader(0, patterns, mode) {}
+
+  wkfw::Text operator()() const throw(wkfw::WorkerExecuteException) {
+    return reader.execute(wkfw::WorkerResult()).getValue();
+  }
+
+ private:
+  workers::ReadFile reader;
+};
+
+/**
+ * Выбор строк, содержащих слово, как grep.
+ */
+class Grep : public LineStage {
+ public:
+  explicit Grep(const std::string& pattern) : pattern(pattern) {}
+
+  bool operator()(wkfw::Line& line) const {
+    return line.find(pattern) != std::string::npos;
+  }
+
+ private:
+  std::string pattern;
+};
+
+/**
+ * Замена слова, как replace.
+ */
+class Replace : public LineStage {
+ public:
+  Replace(const std::string& pattern, const std::string& substitution)
+      : pattern(pattern), substitution(substitution) {}
+
+  bool operator()(wkfw::Line& line) {
+    size_t index = line.find(pattern);
+    if (index == std::string::npos)
+      return true;
+
+    const size_t step = std::max<size_t>(pattern.size(), 1);
+    size_t copied = 0;
+    buffer.clear();
+    while (index != std::string::npos) {
+      buffer.append(line.data + copied, index - copied);
+      buffer += substitution;
+      copied = index + pattern.size();
+      index = line.find(pattern, index + step);
+    }
+    buffer.append(line.data + copied, line.size - copied);
+    line = wkfw::Line(buffer);
+    return true;
+  }
+
+ private:
+  std::string pattern;
+  std::string substitution;
+  std::string buffer;
+};
+
+/**
+ * Выбор полей, как cut.
+ */
+class Cut : public LineStage {
+ public:
+  explicit Cut(const std::vector<size_t>& fields) : fields(fields) {}
+
+  bool operator()(wkfw::Line& line) {
+    buffer.clear();
+    for (size_t j = 0; j < fields.size(); j++) {
+      const wkfw::FieldSpan span =
+          wkfw::FieldIndex::findField(line.data, line.size, fields[j]);
+      if (j > 0)
+        buffer += '\t';
+      buffer.append(line.data + span.begin, span.size());
+    }
+    line = wkfw::Line(buffer);
+    return true;
+  }
+
+ private:
+  std::vector<size_t> fields;
+  std::string buffer;
+};
+
+/**
+ * Сортировка, как sort.
+ */
+class Sort : public TextStage {
+ public:
+  explicit Sort(const workers::Sort::Collapse collapse =
+                    workers::Sort::Collapse::NONE,
+                const size_t field = 0,
+                const workers::Sort::Order order = workers::Sort::Order::TEXT)
+      : sort(0, collapse, field, order) {}
+
+  wkfw::Text operator()(const wkfw::Text& text) const
+      throw(wkfw::WorkerExecuteException) {
+    wkfw::Text copy(text);
+    return sort.execute(wkfw::WorkerResult(std::move(copy))).getValue();
+  }
+
+ private:
+  workers::Sort sort;
+};
+
+/**
+ * Запись в файл, как writefile.
+ */
+class WriteFile : public Sink {
+ public:
+  explicit WriteFile(const std::string& filename) : writer(0, filename) {}
+
+  void operator()(const wkfw::Text& text) const
+      throw(wkfw::WorkerExecuteException) {
+    wkfw::Text copy(text);
+    writer.execute(wkfw::WorkerResult(std::move(copy)));
+  }
+
+ private:
+  workers::WriteFile writer;
+};
+
+}  // namespace stages
+
+namespace wkfw {
+
+/**
+ * Конвейер с известными при компиляции типами этапов: начало, этапы,
+ * завершение. Подряд идущие построчные этапы сливаются в один цикл
+ * по строкам, в котором вызовы этапов встраиваются компилятором:
+ * ни виртуальных вызовов, ни поиска блоков по номеру на строку.
+ * Строки, которые этапы не изменили, не копируются.
+ *
+ * Этапы - свои, построчные этапы хранят буферы строк, поэтому один
+ * конвейер исполняется одним потоком.
+ */
+template <typename... Stages>
+class Pipeline {
+ public:
+  static_assert(sizeof...(Stages) >= 2,
+                "Pipeline needs a source and a sink.");
+
+  explicit Pipeline(Stages... stages) : stages(std::move(stages)...) {}
+
+  /**
+   * Исполняет конвейер.
+   */
+  void run() throw(WorkerExecuteException) { run<1>(std::get<0>(stages)()); }
+
+ private:
+  typedef std::tuple<Stages...> StageTuple;
+  static const size_t COUNT = sizeof...(Stages);
+
+  template <size_t I>
+  using Stage = typename std::tuple_element<I, StageTuple>::type;
+
+  static_assert(std::is_base_of<stages::Source, Stage<0>>::value,
+                "Pipeline must start with a source.");
+  static_assert(std::is_base_of<stages::Sink, Stage<COUNT - 1>>::value,
+                "Pipeline must end with a sink.");
+
+  StageTuple stages;
+
+  template <size_t I, bool = (I < COUNT)>
+  struct IsLine : std::false_type {};
+
+  template <size_t I>
+  struct IsLine<I, true>
+      : std::is_base_of<stages::LineStage, Stage<I>> {};
+
+  /**
+   * Первый этап, начиная с I, не являющийся построчным.
+   */
+  template <size_t I, bool = IsLine<I>::value>
+  struct LineEnd : std::integral_constant<size_t, I> {};
+
+  template <size_t I>
+  struct LineEnd<I, true> : LineEnd<I + 1> {};
+
+  /**
+   * Применяет построчные этапы [I, J) к строке.
+   */
+  template <size_t I, size_t J>
+  typename std::enable_if<I == J, bool>::type applyLine(Line&) {
+    return true;
+  }
+
+  template <size_t I, size_t J>
+  typename std::enable_if<(I < J), bool>::type applyLine(Line& line) {
+    return std::get<I>(stages)(line) && applyLine<I + 1, J>(line);
+  }
+
+  /**
+   * Подряд идущие построчные этапы: один цикл по строкам.
+   */
+  template <size_t I>
+  typename std::enable_if<IsLine<I>::value>::type run(const Text& text) {
+    TextBuilder list;
+    list.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+      const Line original = text[i];
+      Line line = original;
+      if (!applyLine<I, LineEnd<I>::value>(line))
+        continue;
+      if (line.data == original.data && line.size == original.size)
+        list.keep(text, i);
+      else
+        list.add(line.data, line.size);
+    }
+    run<LineEnd<I>::value>(list.build());
+  }
+
+  template <size_t I>
+  typename std::enable_if<!IsLine<I>::value && I + 1 < COUNT>::type run(
+      const Text& text) {
+    run<I + 1>(std::get<I>(stages)(text));
+  }
+
+  template <size_t I>
+  typename std::enable_if<I + 1 == COUNT>::type run(const Text& text) {
+    std::get<I>(stages)(text);
+  }
+};
+
+/**
+ * Собирает конвейер из этапов, например
+ * pipeline(stages::ReadFile("in"), stages::Grep("x"), stages::Sort(),
+ *          stages::WriteFile("out")).run();
+ */
+template <typename... Stages>
+Pipeline<typename std::decay<Stages>::type...> pipeline(Stages&&... stages) {
+  return Pipeline<typename std::decay<Stages>::type...>(
+      std::forward<Stages>(stages)...);
+}
+
+}  // namespace wkfw
+
+#endif /* PIPELINE_H_ */
@@ -0,0 +1,135 @@
+//
+//  result_cache.cpp
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "result_cache.h"
+
+namespace wkfw {
+
+static const char RESULT_MAGIC[8] = {'W', 'K', 'F', 'W', 'R', 'E', 'S', '2'};
+
+bool writeResult(std::ostream& output, const WorkerResult& result) {
+  if (result.getType() != WorkerResult::TEXT)
+    return false;
+
+  const Text& lines = result.getValue();
+  uint64_t header[2] = {lines.size(), 0};
+  for (auto const& line : lines)
+    header[1] += line.size + 1;
+
+  output.write(RESULT_MAGIC, sizeof(RESULT_MAGIC));
+  output.write((const char*)header, sizeof(header));
+  const TextColumn* column = lines.getColumn();
+  if (column != nullptr && !lines.isSelection() && column->isTerminated() &&
+      column->getLength() == header[1]) {
+    output.write(column->getBytes(), column->getLength());
+  } else {
+    for (auto const& line : lines)
+      output.write(line.data, line.size).put('\n');
+  }
+
+  return (bool)output;
+}
+
+bool readResult(std::istream& input, WorkerResult& result) {
+  char magic[sizeof(RESULT_MAGIC)];
+  uint64_t header[2];
+
+  if (!input.read(magic, sizeof(magic)) ||
+      memcmp(magic, RESULT_MAGIC, sizeof(magic)) != 0 ||
+      !input.read((char*)header, sizeof(header)))
+    return false;
+
+  // Заголовок мог быть поврежден: байты строк должны быть в файле,
+  // а каждая строка занимает хотя бы перенос строки
+  const std::streampos start = input.tellg();
+  if (start < 0 || !input.seekg(0, std::ios::end))
+    return false;
+  const uint64_t remaining = input.tellg() - start;
+  if (!input.seekg(start) || header[1] > remaining || header[0] > header[1])
+    return false;
+
+  // Содержимое всех строк считывается одним вызовом прямо в столбец
+  TextBuilder lines;
+  lines.reserve(header[0]);
+  char* bytes = lines.reserveBytes(header[1]);
+  if (header[1] > 0 && !input.read(bytes, header[1]))
+    return false;
+  lines.addLines(header[1]);
+  if (lines.size() != header[0])
+    return false;
+
+  result = WorkerResult(lines.build());
+  return true;
+}
+
+ResultCache::ResultCache(const std::string& directory)
+    : directory(directory) {
+  mkdir(directory.c_str(), 0755);
+}
+
+/**
+ * 64-битный FNV-1a.
+ */
+static uint64_t hashString(const std::string& data, uint64_t basis) {
+  uint64_t hash = basis;
+  for (unsigned char symbol : data) {
+    hash ^= symbol;
+    hash *= 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+std::string ResultCache::makeKey(const std::string& previous,
+                                 const std::string& fingerprint) {
+  const std::string data =
+      std::to_string(previous.size()) + " " + previous + fingerprint;
+  char key[33];
+  snprintf(key, sizeof(key), "%016llx%016llx",
+           (unsigned long long)hashString(data, 0xCBF29CE484222325ULL),
+           (unsigned long long)hashString(data, 0x84222325CBF29CE4ULL));
+  return key;
+}
+
+std::string ResultCache::getPath(const std::string& key) const {
+  return directory + "/" + key + ".wfr";
+}
+
+bool ResultCache::load(const std::string& key, WorkerResult& result) const {
+  std::ifstream input(getPath(key), std::ios::binary);
+  return input.is_open() && readResult(input, result);
+}
+
+void ResultCache::store(const std::string& key,
+                        const WorkerResult& result) const {
+  // Запись во временный файл и переименование, чтобы параллельные запуски
+  // никогда не видели частично записанный результат
+  const std::string path = getPath(key);
+  const std::string temporary =
+      path + "." + std::to_string(getpid()) + "." +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+  std::ofstream output(temporary, std::ios::binary);
+  bool written = output.is_open() && writeResult(output, result);
+  output.close();
+
+  if (!written || !output || rename(temporary.c_str(), path.c_str()) != 0)
+    remove(temporary.c_str());
+}
+
+}  // namespace wkfw
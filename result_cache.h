@@ -0,0 +1,78 @@
+//
+//  result_cache.h
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef RESULT_CACHE_H_
+#define RESULT_CACHE_H_
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "worker.h"
+
+namespace wkfw {
+
+/**
+ * Записывает текстовый результат в поток в двоичном формате:
+ * заголовок, количество строк, их общая длина и затем строки, каждая
+ * с переносом строки, - при чтении они делятся на месте.
+ *
+ * @return true, если запись прошла успешно.
+ */
+bool writeResult(std::ostream& output, const WorkerResult& result);
+
+/**
+ * Считывает результат, записанный writeResult().
+ *
+ * @return true, если данные корректны.
+ */
+bool readResult(std::istream& input, WorkerResult& result);
+
+/**
+ * Кэш результатов детерминированных блоков в локальной директории.
+ *
+ * Ключ результата блока вычисляется по ключу предыдущего блока и отпечатку
+ * текущего (Worker::getFingerprint()), поэтому совпадение ключей означает
+ * совпадение всего префикса конвейера вместе с входными файлами.
+ */
+class ResultCache {
+ public:
+  /**
+   * @param directory Директория кэша. Создается при отсутствии.
+   */
+  ResultCache(const std::string& directory);
+
+  /**
+   * Вычисляет ключ результата блока.
+   *
+   * @param previous Ключ результата предыдущего блока или пустая строка.
+   * @param fingerprint Отпечаток блока.
+   */
+  static std::string makeKey(const std::string& previous,
+                             const std::string& fingerprint);
+
+  /**
+   * @return true, если результат найден и прочитан.
+   */
+  bool load(const std::string& key, WorkerResult& result) const;
+
+  /**
+   * Сохраняет результат. Ошибки записи игнорируются:
+   * кэш влияет только на скорость.
+   */
+  void store(const std::string& key, const WorkerResult& result) const;
+
+ private:
+  const std::string directory;
+
+  std::string getPath(const std::string& key) const;
+};
+
+}  // namespace wkfw
+
+#endif /* RESULT_CACHE_H_ */
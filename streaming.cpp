@@ -0,0 +1,276 @@
+//
+//  streaming.cpp
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <cstdio>
+#include <functional>
+
+#include "streaming.h"
+
+namespace wkfw {
+
+// Объем строк результата, записываемых за один раз
+static const size_t OUTPUT_BATCH_SIZE = 1 << 20;
+
+// Объем части сортировки, если память не ограничена
+static const size_t DEFAULT_RUN_SIZE = 256 << 20;
+
+// Память на строку части сортировки сверх ее байт: ссылка на строку
+// в тексте и рабочая память сортировки
+static const size_t RUN_LINE_OVERHEAD = 4 * sizeof(Line);
+
+size_t LinearChain::parse(const std::vector<const Worker*>& chain) {
+  if (!chain.empty())
+    reader = dynamic_cast<const workers::ReadFile*>(chain.front());
+  if (reader == nullptr)
+    return 0;
+
+  for (size_t i = 1; i < chain.size(); i++) {
+    auto lineWorker = dynamic_cast<const workers::LineWorker*>(chain[i]);
+    if (lineWorker != nullptr) {
+      (sort == nullptr ? prefix : suffix).push_back(lineWorker);
+    } else if (sort == nullptr &&
+               dynamic_cast<const workers::Sort*>(chain[i]) != nullptr) {
+      sort = dynamic_cast<const workers::Sort*>(chain[i]);
+    } else if (i + 1 == chain.size() &&
+               chain[i]->getReturnType() == WorkerResult::NONE &&
+               dynamic_cast<const workers::WriteFile*>(chain[i]) != nullptr) {
+      writer = dynamic_cast<const workers::WriteFile*>(chain[i]);
+    } else {
+      return i;
+    }
+  }
+
+  return chain.size();
+}
+
+/**
+ * Построчные блоки над потоком строк: строки накапливаются порциями
+ * по BATCH_LINES, и каждая порция проходит блоки целиком.
+ */
+class StageBatch {
+ public:
+  /**
+   * @param consumer Получатель строк результата, строка действительна
+   * только во время вызова.
+   */
+  StageBatch(const std::vector<const workers::LineWorker*>& stages,
+             std::shared_ptr<MemoryBudget> budget,
+             const std::function<void(const Line&)>& consumer)
+      : stages(stages), budget(budget), consumer(consumer) {}
+
+  void add(const std::string& line) throw(WorkerExecuteException) {
+    if (!batch) {
+      arena = std::make_shared<Arena>(budget);
+      batch.reset(new TextBuilder(arena));
+    }
+    batch->add(line);
+    if (batch->size() >= workers::BATCH_LINES)
+      flush();
+  }
+
+  /**
+   * Обрабатывает накопленные строки.
+   */
+  void flush() throw(WorkerExecuteException) {
+    if (!batch)
+      return;
+    const Text kept =
+        workers::applyLineWorkers(stages, batch->build(), arena);
+    batch.reset();
+    arena.reset();
+    for (auto const& line : kept)
+      consumer(line);
+  }
+
+ private:
+  const std::vector<const workers::LineWorker*> stages;
+  std::shared_ptr<MemoryBudget> budget;
+  const std::function<void(const Line&)> consumer;
+  std::shared_ptr<Arena> arena;
+  std::unique_ptr<TextBuilder> batch;
+};
+
+/**
+ * Запись результата частями: первая часть перезаписывает файл,
+ * остальные дописываются в его конец.
+ */
+class BatchWriter {
+ public:
+  BatchWriter(const workers::WriteFile* writer,
+              std::shared_ptr<MemoryBudget> budget)
+      : writer(writer), budget(budget), size(0), written(false) {}
+
+  void add(const Line& line) throw(WorkerExecuteException) {
+    if (!batch)
+      batch.reset(new TextBuilder(std::make_shared<Arena>(budget)));
+    batch->add(line.data, line.size);
+    size += line.size + 1;
+    if (size >= OUTPUT_BATCH_SIZE)
+      flush();
+  }
+
+  /**
+   * Записывает накопленные строки. Файл создается, даже если строк нет.
+   */
+  void flush() throw(WorkerExecuteException) {
+    WorkerResult result(batch ? batch->build() : Text());
+    if (written)
+      writer->append(result);
+    else
+      writer->execute(result);
+    written = true;
+    batch.reset();
+    size = 0;
+  }
+
+ private:
+  const workers::WriteFile* writer;
+  std::shared_ptr<MemoryBudget> budget;
+  std::unique_ptr<TextBuilder> batch;
+  size_t size;
+  bool written;
+};
+
+/**
+ * Внешняя сортировка: строки накапливаются частями в пределах памяти,
+ * каждая часть сортируется и сбрасывается на диск.
+ */
+class SortRuns {
+ public:
+  SortRuns(const workers::Sort* sort, std::shared_ptr<MemoryBudget> budget)
+      : sort(sort),
+        budget(budget),
+        runSize(budget ? budget->getAvailable() / 4 : DEFAULT_RUN_SIZE),
+        size(0) {}
+  SortRuns(const SortRuns&) = delete;
+  SortRuns& operator=(const SortRuns&) = delete;
+
+  ~SortRuns() {
+    for (auto run : runs)
+      fclose(run);
+  }
+
+  void add(const Line& line) throw(WorkerExecuteException) {
+    if (!run) {
+      arena = std::make_shared<Arena>(budget);
+      run.reset(new TextBuilder(arena));
+    }
+    run->add(line.data, line.size);
+    size += line.size + RUN_LINE_OVERHEAD;
+    if (size >= runSize)
+      spill();
+  }
+
+  /**
+   * Передает обработчику отсортированный текст по одной строке.
+   * Если ничего не сброшено на диск, последняя часть сортируется в памяти.
+   */
+  void finish(const std::function<bool(std::string&)>& consumer) throw(
+      WorkerExecuteException) {
+    if (runs.empty()) {
+      if (!run)
+        return;
+      const WorkerResult sorted = sortRun();
+      for (auto const& sortedLine : sorted.getValue()) {
+        std::string line = sortedLine.str();
+        if (!consumer(line))
+          return;
+      }
+      return;
+    }
+
+    if (run)
+      spill();
+    sort->mergeRuns(runs, consumer);
+  }
+
+ private:
+  const workers::Sort* sort;
+  std::shared_ptr<MemoryBudget> budget;
+  const size_t runSize;
+  std::shared_ptr<Arena> arena;
+  std::unique_ptr<TextBuilder> run;
+  size_t size;
+  std::vector<std::FILE*> runs;
+
+  /**
+   * Сортирует накопленную часть, память части освобождается вместе
+   * с результатом.
+   */
+  WorkerResult sortRun() throw(WorkerExecuteException) {
+    WorkerResult sorted =
+        sort->execute(WorkerResult(run->build()).withArena(arena));
+    run.reset();
+    arena.reset();
+    size = 0;
+    return sorted;
+  }
+
+  void spill() throw(WorkerExecuteException) {
+    const WorkerResult sorted = sortRun();
+    runs.push_back(sort->spill(sorted.getValue()));
+  }
+};
+
+void executeStreaming(const LinearChain& chain,
+                      std::shared_ptr<MemoryBudget> budget) throw(
+    WorkerExecuteException) {
+  BatchWriter output(chain.writer, budget);
+  std::unique_ptr<SortRuns> runs;
+  if (chain.sort != nullptr)
+    runs.reset(new SortRuns(chain.sort, budget));
+
+  StageBatch prefix(chain.prefix, budget, [&](const Line& line) {
+    if (runs)
+      runs->add(line);
+    else
+      output.add(line);
+  });
+  chain.reader->scan(
+      [&prefix](std::string& line) {
+        prefix.add(line);
+        return true;
+      },
+      false);
+  prefix.flush();
+
+  if (runs) {
+    StageBatch suffix(chain.suffix, budget,
+                      [&output](const Line& line) { output.add(line); });
+    runs->finish([&suffix](std::string& line) {
+      suffix.add(line);
+      return true;
+    });
+    suffix.flush();
+  }
+
+  output.flush();
+}
+
+void executeLazy(const std::vector<const Worker*>& chain,
+                 std::shared_ptr<MemoryBudget> budget) throw(
+    WorkerExecuteException) {
+  std::unique_ptr<Cursor> cursor;
+  for (auto worker : chain)
+    cursor = worker->open(std::move(cursor), budget);
+
+  // Последний блок схемы - запись, каждая выданная им часть уже записана
+  Text batch;
+  bool written = false;
+  try {
+    while (cursor && cursor->next(batch))
+      written = true;
+  } catch (const MemoryLimitException& e) {
+    // Повторное исполнение схемы продублировало бы записанные части
+    if (written)
+      throw WorkerExecuteException(e.what());
+    throw;
+  }
+}
+
+}  // namespace wkfw
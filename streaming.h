@@ -0,0 +1,72 @@
+//
+//  streaming.h
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef STREAMING_H_
+#define STREAMING_H_
+
+#include <memory>
+#include <vector>
+
+#include "worker.h"
+#include "workers.h"
+
+namespace wkfw {
+
+/**
+ * Линейный конвейер вида
+ * readfile -> построчные блоки -> [sort -> построчные блоки] -> writefile,
+ * который можно исполнять по частям текста.
+ */
+struct LinearChain {
+  const workers::ReadFile* reader = nullptr;
+  std::vector<const workers::LineWorker*> prefix;
+  const workers::Sort* sort = nullptr;
+  std::vector<const workers::LineWorker*> suffix;
+  const workers::WriteFile* writer = nullptr;
+
+  /**
+   * Разбирает конвейер на части.
+   *
+   * @return Позиция первого блока, не подходящего под вид конвейера,
+   * или chain.size(). Без чтения в начале - 0, запись проверяется по writer.
+   */
+  size_t parse(const std::vector<const Worker*>& chain);
+};
+
+/**
+ * Исполняет конвейер потоково, не держа весь текст в памяти: строки
+ * читаются по одной и проходят построчные блоки, результат записывается
+ * частями. Сортировка накапливает части текста в пределах свободной памяти,
+ * сбрасывает их отсортированными на диск и затем сливает.
+ *
+ * @param budget Учет памяти исполнения или nullptr.
+ */
+void executeStreaming(const LinearChain& chain,
+                      std::shared_ptr<MemoryBudget> budget) throw(
+    WorkerExecuteException);
+
+/**
+ * Исполняет линейную схему лениво: последний блок запрашивает части текста
+ * у предыдущего, тот - у своего предыдущего и так до чтения файла
+ * (см. Worker::open). Части, которые не нужны последующим блокам
+ * (например, после head), не вычисляются, промежуточные тексты целиком
+ * собирают только блоки, которым нужен весь вход.
+ *
+ * @param chain Блоки схемы в порядке исполнения.
+ * @param budget Учет памяти исполнения или nullptr.
+ * @throw MemoryLimitException Если память кончилась до записи первой части
+ * результата: схему можно исполнить заново другим способом. После записи
+ * нехватка памяти сообщается как WorkerExecuteException.
+ */
+void executeLazy(const std::vector<const Worker*>& chain,
+                 std::shared_ptr<MemoryBudget> budget) throw(
+    WorkerExecuteException);
+
+}  // namespace wkfw
+
+#endif /* STREAMING_H_ */
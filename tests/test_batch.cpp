@@ -0,0 +1,82 @@
+//
+//  test_batch.cpp
+//  WorkflowTests
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "workflow_batch.h"
+
+using namespace wkfw;
+
+static const std::string BATCH_INPUT = "._temp_test_batch_in_";
+static const std::string BATCH_OUTPUT_A = "._temp_test_batch_a_";
+static const std::string BATCH_OUTPUT_B = "._temp_test_batch_b_";
+
+/**
+ * Удаляет временные файлы по завершении теста.
+ */
+class BatchTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::ofstream(BATCH_INPUT) << "cab\nxyz\nabc\nbar\n";
+  }
+
+  void TearDown() override {
+    remove(BATCH_INPUT.c_str());
+    remove(BATCH_OUTPUT_A.c_str());
+    remove(BATCH_OUTPUT_B.c_str());
+  }
+
+  std::shared_ptr<const Workflow> make(const std::string& text,
+                                       const std::string& ofname) {
+    std::istringstream stream(text);
+    return std::make_shared<Workflow>(stream, BATCH_INPUT, ofname);
+  }
+
+  std::vector<std::string> readLines(const std::string& filename) {
+    std::ifstream file(filename);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line))
+      lines.push_back(line);
+    return lines;
+  }
+};
+
+TEST_F(BatchTest, SharesCommonPrefix) {
+  WorkflowBatch batch;
+
+  batch.add("a", make("desc 1 = grep a 2 = sort csed 1 -> 2", BATCH_OUTPUT_A));
+  batch.add("b", make("desc 1 = grep a 2 = sort 3 = replace a A csed "
+                      "1 -> 2 -> 3",
+                      BATCH_OUTPUT_B));
+
+  // readfile, grep и sort общие, replace и две записи - отдельные
+  ASSERT_EQ(batch.getNodesCount(), 6);
+
+  batch.execute();
+  ASSERT_EQ(readLines(BATCH_OUTPUT_A),
+            std::vector<std::string>({"abc", "bar", "cab"}));
+  ASSERT_EQ(readLines(BATCH_OUTPUT_B),
+            std::vector<std::string>({"Abc", "bAr", "cAb"}));
+}
+
+TEST_F(BatchTest, ContinuesAfterError) {
+  WorkflowBatch batch;
+
+  batch.add("a", make("desc 1 = readfile ._temp_test_batch_none_ csed 1",
+                      BATCH_OUTPUT_A));
+  batch.add("b", make("desc 1 = sort csed 1", BATCH_OUTPUT_B));
+
+  ASSERT_THROW(batch.execute(), WorkerExecuteException);
+  ASSERT_EQ(readLines(BATCH_OUTPUT_B),
+            std::vector<std::string>({"abc", "bar", "cab", "xyz"}));
+}
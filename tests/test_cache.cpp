@@ -0,0 +1,124 @@
+//
+//  test_cache.cpp
+//  WorkflowTests
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "result_cache.h"
+#include "workers.h"
+#include "workflow.h"
+
+using namespace wkfw;
+
+static const std::string CACHE_DIRECTORY = "._temp_test_cache_";
+static const std::string CACHE_INPUT = "._temp_test_cache_in_";
+static const std::string CACHE_OUTPUT = "._temp_test_cache_out_";
+
+/**
+ * Удаляет временные файлы и директорию кэша по завершении теста.
+ */
+class ResultCacheTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    DIR* directory = opendir(CACHE_DIRECTORY.c_str());
+    if (directory != nullptr) {
+      while (struct dirent* entry = readdir(directory))
+        remove((CACHE_DIRECTORY + "/" + entry->d_name).c_str());
+      closedir(directory);
+    }
+    rmdir(CACHE_DIRECTORY.c_str());
+    remove(CACHE_INPUT.c_str());
+    remove(CACHE_OUTPUT.c_str());
+  }
+
+  std::vector<std::string> readLines(const std::string& filename) {
+    std::ifstream file(filename);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line))
+      lines.push_back(line);
+    return lines;
+  }
+
+  void run(std::shared_ptr<const ResultCache> cache) {
+    std::istringstream text("desc 1 = grep a 2 = sort csed 1 -> 2");
+    Workflow workflow(text, CACHE_INPUT, CACHE_OUTPUT);
+    workflow.setResultCache(cache);
+    workflow.execute();
+  }
+};
+
+TEST(ResultCache, Serialization) {
+  std::vector<std::vector<std::string>> samples = {
+      {}, {""}, {"abc", "", "de\0f"}, {std::string(100000, 'x'), "y"}};
+
+  for (auto const& sample : samples) {
+    std::stringstream stream;
+    WorkerResult result;
+    ASSERT_TRUE(writeResult(stream, WorkerResult(sample)));
+    ASSERT_TRUE(readResult(stream, result));
+    ASSERT_EQ(result, WorkerResult(sample));
+  }
+
+  std::stringstream broken("WKFWRES2\x05");
+  WorkerResult result;
+  ASSERT_FALSE(readResult(broken, result));
+
+  // Поврежденный заголовок и обрезанный файл - промах, а не исключение
+  const uint64_t headers[][2] = {
+      {~0ULL, ~0ULL}, {1, ~0ULL}, {~0ULL, 4}, {2, 8}};
+  for (auto const& header : headers) {
+    std::stringstream corrupt;
+    corrupt.write("WKFWRES2", 8);
+    corrupt.write((const char*)header, sizeof(header));
+    corrupt.write("ab\ncd\n", 6);
+    ASSERT_FALSE(readResult(corrupt, result));
+  }
+}
+
+TEST(ResultCache, Keys) {
+  ASSERT_EQ(ResultCache::makeKey("", "sort"), ResultCache::makeKey("", "sort"));
+  ASSERT_NE(ResultCache::makeKey("", "sort"), ResultCache::makeKey("", "grep a"));
+  ASSERT_NE(ResultCache::makeKey("a", "sort"), ResultCache::makeKey("", "asort"));
+}
+
+TEST_F(ResultCacheTest, SkipsCachedPrefix) {
+  auto cache = std::make_shared<ResultCache>(CACHE_DIRECTORY);
+  std::ofstream(CACHE_INPUT) << "cab\nxyz\nabc\n";
+
+  run(cache);
+  ASSERT_EQ(readLines(CACHE_OUTPUT), std::vector<std::string>({"abc", "cab"}));
+
+  // Подменяем закэшированный результат всего конвейера: повторный запуск
+  // должен взять его, не исполняя блоки
+  workers::ReadFile reader(0, CACHE_INPUT);
+  workers::Grep grep(0, "a");
+  workers::Sort sort(0);
+  std::string key = ResultCache::makeKey("", reader.getFingerprint());
+  key = ResultCache::makeKey(key, grep.getFingerprint());
+  key = ResultCache::makeKey(key, sort.getFingerprint());
+  WorkerResult stored;
+  ASSERT_TRUE(cache->load(key, stored));
+  ASSERT_EQ(stored, WorkerResult({"abc", "cab"}));
+  cache->store(key, WorkerResult({"cached"}));
+
+  run(cache);
+  ASSERT_EQ(readLines(CACHE_OUTPUT), std::vector<std::string>({"cached"}));
+
+  // Изменение входного файла делает кэш недействительным
+  std::ofstream(CACHE_INPUT) << "cab\nxyz\nabc\nbar\n";
+  run(cache);
+  ASSERT_EQ(readLines(CACHE_OUTPUT),
+            std::vector<std::string>({"abc", "bar", "cab"}));
+}
@@ -0,0 +1,125 @@
+//
+//  test_incremental.cpp
+//  WorkflowTests
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "workflow.h"
+
+using namespace wkfw;
+
+static const std::string INCREMENTAL_INPUT = "._temp_test_inc_in_";
+static const std::string INCREMENTAL_OUTPUT = "._temp_test_inc_out_";
+static const std::string INCREMENTAL_STATE = "._temp_test_inc_state_";
+
+/**
+ * Удаляет временные файлы по завершении теста.
+ */
+class IncrementalTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    remove(INCREMENTAL_INPUT.c_str());
+    remove(INCREMENTAL_OUTPUT.c_str());
+    remove(INCREMENTAL_STATE.c_str());
+  }
+
+  void append(const std::string& content) {
+    std::ofstream(INCREMENTAL_INPUT, std::ios::app) << content;
+  }
+
+  std::vector<std::string> run(const std::string& text) {
+    std::istringstream stream(text);
+    Workflow workflow(stream, INCREMENTAL_INPUT, INCREMENTAL_OUTPUT);
+    workflow.setIncrementalState(INCREMENTAL_STATE);
+    workflow.execute();
+
+    std::ifstream file(INCREMENTAL_OUTPUT);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line))
+      lines.push_back(line);
+    return lines;
+  }
+};
+
+TEST_F(IncrementalTest, AppendsStatelessStages) {
+  const std::string text = "desc 1 = grep a 2 = replace a A csed 1 -> 2";
+
+  append("abc\nxyz\n");
+  ASSERT_EQ(run(text), std::vector<std::string>({"Abc"}));
+
+  // Незавершенная строка обрабатывается после ее завершения
+  append("bar\nca");
+  ASSERT_EQ(run(text), std::vector<std::string>({"Abc", "bAr"}));
+
+  append("t\n");
+  ASSERT_EQ(run(text), std::vector<std::string>({"Abc", "bAr", "cAt"}));
+}
+
+TEST_F(IncrementalTest, RecoversInterruptedAppend) {
+  const std::string text = "desc 1 = grep a csed 1";
+
+  append("abc\n");
+  ASSERT_EQ(run(text), std::vector<std::string>({"abc"}));
+  std::ifstream saved(INCREMENTAL_STATE, std::ios::binary);
+  const std::string state((std::istreambuf_iterator<char>(saved)),
+                          std::istreambuf_iterator<char>());
+
+  // Результат дописан, а состояние не сохранено: строки не повторяются
+  append("bar\n");
+  ASSERT_EQ(run(text), std::vector<std::string>({"abc", "bar"}));
+  std::ofstream(INCREMENTAL_STATE, std::ios::binary) << state;
+  ASSERT_EQ(run(text), std::vector<std::string>({"abc", "bar"}));
+}
+
+TEST_F(IncrementalTest, MergesSortedOutput) {
+  const std::string text = "desc 1 = grep a 2 = sort 3 = replace a A csed "
+                           "1 -> 2 -> 3";
+
+  append("cab\nxyz\nabc\n");
+  ASSERT_EQ(run(text), std::vector<std::string>({"Abc", "cAb"}));
+
+  append("bar\nzzz\naaa\n");
+  ASSERT_EQ(run(text),
+            std::vector<std::string>({"AAA", "Abc", "bAr", "cAb"}));
+}
+
+TEST_F(IncrementalTest, MergesCountedOutput) {
+  const std::string text = "desc 1 = sort count csed 1";
+
+  append("b\na\nb\n");
+  ASSERT_EQ(run(text), std::vector<std::string>({"1\ta", "2\tb"}));
+
+  append("c\nb\n");
+  ASSERT_EQ(run(text), std::vector<std::string>({"1\ta", "3\tb", "1\tc"}));
+}
+
+TEST_F(IncrementalTest, RestartsOnReplacedInput) {
+  const std::string text = "desc 1 = sort csed 1";
+
+  append("b\na\n");
+  ASSERT_EQ(run(text), std::vector<std::string>({"a", "b"}));
+
+  std::ofstream(INCREMENTAL_INPUT) << "d\nc\nx\n";
+  ASSERT_EQ(run(text), std::vector<std::string>({"c", "d", "x"}));
+
+  // Изменение схемы также начинает обработку сначала
+  ASSERT_EQ(run("desc 1 = grep x csed 1"), std::vector<std::string>({"x"}));
+}
+
+TEST_F(IncrementalTest, Wrong) {
+  append("abc\n");
+
+  ASSERT_THROW(run("desc 1 = dump ._temp_test_inc_dump_ csed 1"),
+               WorkerExecuteException);
+  ASSERT_THROW(run("desc 1 = sort 2 = sort csed 1 -> 2"),
+               WorkerExecuteException);
+}
@@ -11,6 +11,7 @@
 #include <vector>
 #include <sstream>
 
+#include "workers.h"
 #include "workflow_parser.h"
 
 static const std::vector<std::string> rightSamples = {
@@ -75,7 +76,46 @@ static const std::vector<std::string> rightSamples = {
   1 = readfile in.txt\
   2 = writefile out.txt\
   csed\
-  1 -> 0 -> 2"
+  1 -> 0 -> 2",
+  
+  // ======================================
+  // Ветвление с общим префиксом
+  // ======================================
+  
+  "desc\
+  0 = readfile in.txt\
+  1 = grep a\
+  2 = sort\
+  3 = writefile a.txt\
+  4 = replace a b\
+  5 = writefile b.txt\
+  csed\
+  0 -> 1 -> 2 -> 3\
+  0 -> 1 -> 4 -> 5",
+  
+  // ======================================
+  // Слияние
+  // ======================================
+  
+  "desc\
+  1 = readfile a.txt\
+  3 = sort\
+  4 = writefile c.txt\
+  2 = readfile b.txt\
+  csed\
+  1 -> 3 -> 4\
+  2 -> 3",
+  
+  // ======================================
+  // Числовые аргументы команд
+  // ======================================
+  
+  "desc\
+  1 = readfile 2017\
+  2 = head 10\
+  3 = writefile 5\
+  csed\
+  1 -> 2 -> 3"
   
   // ======================================
 };
@@ -134,7 +174,26 @@ static const std::vector<std::string> wrongSamples = {
   1 = readfile i.txt\
   2 = sort\
   3 = writefile o.txt\
-  csed"
+  csed",
+  
+  // ======================================
+  // Цикл
+  // ======================================
+  
+  "desc\
+  1 = replace a b\
+  2 = replace b a\
+  csed\
+  1 -> 2 -> 1",
+  
+  // ======================================
+  // Петля
+  // ======================================
+  
+  "desc\
+  1 = sort\
+  csed\
+  1 -> 1"
   
   // ======================================
 };
@@ -172,6 +231,68 @@ TEST(Parser, Right) {
   ASSERT_TRUE(checkParser(rightSamples[2], { 1 }, { 1 }));
   ASSERT_TRUE(checkParser(rightSamples[3], { 1, 2, 3, 4, 5, 6 }, { 3, 2, 4, 5, 6, 1 }));
   ASSERT_TRUE(checkParser(rightSamples[4], { 0, 1, 2 }, { 1, 0, 2 }));
+  ASSERT_TRUE(checkParser(rightSamples[5], { 0, 1, 2, 3, 4, 5 }, { 0, 1, 2, 3, 4, 5 }));
+  ASSERT_TRUE(checkParser(rightSamples[6], { 1, 2, 3, 4 }, { 1, 2, 3, 4 }));
+  ASSERT_TRUE(checkParser(rightSamples[7], { 1, 2, 3 }, { 1, 2, 3 }));
+}
+
+TEST(Parser, Graph) {
+  std::istringstream branches(rightSamples[5]);
+  wkfw::WorkflowParser branchesParser(branches);
+  
+  ASSERT_EQ(branchesParser.getInputs(0), std::vector<size_t>());
+  ASSERT_EQ(branchesParser.getInputs(1), std::vector<size_t>({ 0 }));
+  ASSERT_EQ(branchesParser.getInputs(2), std::vector<size_t>({ 1 }));
+  ASSERT_EQ(branchesParser.getInputs(4), std::vector<size_t>({ 1 }));
+  
+  std::istringstream merge(rightSamples[6]);
+  wkfw::WorkflowParser mergeParser(merge);
+  
+  ASSERT_EQ(mergeParser.getInputs(3), std::vector<size_t>({ 1, 2 }));
+  ASSERT_EQ(mergeParser.getInputs(4), std::vector<size_t>({ 3 }));
+  
+  // План: 1, 2, 3, 4; входы - позиции шагов
+  ASSERT_EQ(mergeParser.getInstructionsCount(), 4);
+  ASSERT_EQ(mergeParser.getInstruction(2)->getId(), 3);
+  ASSERT_EQ(mergeParser.getInstructionInputs(2), std::vector<size_t>({ 0, 1 }));
+  ASSERT_EQ(mergeParser.getInstructionInputs(3), std::vector<size_t>({ 2 }));
+}
+
+TEST(Parser, NumericArguments) {
+  // Числа после команды - ее аргументы, а не номера инструкций
+  std::istringstream stream("desc\n"
+                            "1 = approxuniq 1000\n"
+                            "2 = top 5\n"
+                            "3 = approxuniq\n"
+                            "csed 1 -> 2 -> 3");
+  wkfw::WorkflowParser parser(stream);
+
+  ASSERT_EQ(parser.getInstructionsCount(), 3);
+  ASSERT_EQ(parser.getWorkerById(1)->getFingerprint(),
+            workers::ApproxUniq(1, 1000).getFingerprint());
+  ASSERT_EQ(parser.getWorkerById(2)->getFingerprint(),
+            workers::Top(2, 5).getFingerprint());
+  ASSERT_EQ(parser.getWorkerById(3)->getFingerprint(),
+            workers::ApproxUniq(3, 0).getFingerprint());
+  ASSERT_EQ(parser.getInputs(3), std::vector<size_t>({ 2 }));
+}
+
+TEST(Parser, Plan) {
+  std::istringstream stream("desc 1 = readfile a.txt 2 = sort 3 = grep a "
+                            "csed 1 -> 2");
+  wkfw::WorkflowParser parser(stream);
+  
+  // Инструкция вне блока исполнения доступна по номеру, но не входит в план
+  ASSERT_NE(parser.getWorkerById(3), nullptr);
+  ASSERT_EQ(parser.getInstructionsCount(), 2);
+  
+  // План обходится повторно теми же обработчиками
+  for (size_t run = 0; run < 3; run++) {
+    parser.resetSteps();
+    ASSERT_EQ(parser.nextInstruction(), parser.getWorkerById(1));
+    ASSERT_EQ(parser.nextInstruction(), parser.getWorkerById(2));
+    ASSERT_EQ(parser.nextInstruction(), nullptr);
+  }
 }
 
 TEST(Parser, Wrong) {
@@ -180,4 +301,6 @@ TEST(Parser, Wrong) {
   ASSERT_THROW(checkParser(wrongSamples[2], { 0 }, { 0 }), wkfw::InvalidWorkflowException);
   ASSERT_THROW(checkParser(wrongSamples[3], { 0 }, { 0 }), wkfw::InvalidWorkflowException);
   ASSERT_THROW(checkParser(wrongSamples[4], { 0 }, { 0 }), wkfw::InvalidWorkflowException);
+  ASSERT_THROW(checkParser(wrongSamples[5], { 0 }, { 0 }), wkfw::InvalidWorkflowException);
+  ASSERT_THROW(checkParser(wrongSamples[6], { 0 }, { 0 }), wkfw::InvalidWorkflowException);
 }
@@ -0,0 +1,76 @@
+//
+//  test_pipeline.cpp
+//  WorkflowTests
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "pipeline.h"
+#include "workflow.h"
+
+using namespace wkfw;
+
+static const std::string PIPELINE_INPUT = "._temp_test_pipeline_in_";
+static const std::string PIPELINE_OUTPUT_A = "._temp_test_pipeline_a_";
+static const std::string PIPELINE_OUTPUT_B = "._temp_test_pipeline_b_";
+
+static std::vector<std::string> readLines(const std::string& filename) {
+  std::ifstream file(filename);
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(file, line))
+    lines.push_back(line);
+  return lines;
+}
+
+TEST(Pipeline, FusedRight) {
+  {
+    std::ofstream input(PIPELINE_INPUT);
+    for (size_t i = 0; i < 20000; i++)
+      input << "host" << i % 7 << " " << i * 7919 % 10007 << " end\n";
+  }
+
+  // Совпадает с исполнением той же схемы блоками
+  pipeline(stages::ReadFile(PIPELINE_INPUT), stages::Grep("host3"),
+           stages::Replace("7", "seven"), stages::Cut({ 2, 1 }),
+           stages::Sort(workers::Sort::Collapse::NONE, 1,
+                        workers::Sort::Order::NUMERIC),
+           stages::Grep("seven"), stages::WriteFile(PIPELINE_OUTPUT_A))
+      .run();
+
+  std::istringstream scheme(
+      "desc 1 = grep host3 2 = replace 7 seven 3 = cut 2,1 "
+      "4 = sort numeric by 1 5 = grep seven csed 1 -> 2 -> 3 -> 4 -> 5");
+  Workflow(scheme, PIPELINE_INPUT, PIPELINE_OUTPUT_B).execute();
+
+  const std::vector<std::string> expected = readLines(PIPELINE_OUTPUT_B);
+  ASSERT_GT(expected.size(), 100);
+  ASSERT_EQ(readLines(PIPELINE_OUTPUT_A), expected);
+
+  // Без построчных этапов и с этапом, отбрасывающим все строки
+  pipeline(stages::ReadFile(PIPELINE_INPUT),
+           stages::WriteFile(PIPELINE_OUTPUT_A))
+      .run();
+  ASSERT_EQ(readLines(PIPELINE_OUTPUT_A), readLines(PIPELINE_INPUT));
+
+  pipeline(stages::ReadFile(PIPELINE_INPUT), stages::Grep("zzz"),
+           stages::WriteFile(PIPELINE_OUTPUT_A))
+      .run();
+  ASSERT_TRUE(readLines(PIPELINE_OUTPUT_A).empty());
+
+  ASSERT_THROW(pipeline(stages::ReadFile("._temp_test_pipeline_none_"),
+                        stages::WriteFile(PIPELINE_OUTPUT_A))
+                   .run(),
+               WorkerExecuteException);
+
+  remove(PIPELINE_INPUT.c_str());
+  remove(PIPELINE_OUTPUT_A.c_str());
+  remove(PIPELINE_OUTPUT_B.c_str());
+}
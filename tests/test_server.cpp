@@ -0,0 +1,214 @@
+//
+//  test_server.cpp
+//  WorkflowTests
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include "workflow_server.h"
+
+using namespace wkfw;
+
+static const std::string SORT_WORKFLOW = "desc 1 = sort csed 1";
+static const std::string GREP_WORKFLOW = "desc 1 = grep a csed 1";
+static const std::string SOCKET_PATH = "._temp_test_socket_";
+
+TEST(PlanCache, ReusesParsedPlan) {
+  PlanCache cache(4);
+
+  auto first = cache.get(SORT_WORKFLOW);
+  auto second = cache.get(SORT_WORKFLOW);
+
+  ASSERT_EQ(first, second);
+  ASSERT_EQ(cache.size(), 1);
+  ASSERT_NE(cache.get(GREP_WORKFLOW), first);
+  ASSERT_EQ(cache.size(), 2);
+}
+
+TEST(PlanCache, EvictsLeastRecentlyUsed) {
+  PlanCache cache(1);
+
+  auto first = cache.get(SORT_WORKFLOW);
+  cache.get(GREP_WORKFLOW);
+
+  ASSERT_EQ(cache.size(), 1);
+  ASSERT_NE(cache.get(SORT_WORKFLOW), first);
+}
+
+TEST(PlanCache, Wrong) {
+  PlanCache cache(4);
+
+  ASSERT_THROW(cache.get("desc 1 = sort csed 2"), InvalidWorkflowException);
+  ASSERT_EQ(cache.size(), 0);
+}
+
+/**
+ * Отправляет запрос серверу и возвращает ответ.
+ */
+static std::string request(const int connection,
+                           const std::string& ifname,
+                           const std::string& ofname,
+                           const std::string& text) {
+  std::string data = ifname + "\n" + ofname + "\n" +
+                     std::to_string(text.size()) + "\n" + text;
+  send(connection, data.data(), data.size(), MSG_NOSIGNAL);
+
+  std::string response;
+  char symbol;
+  while (recv(connection, &symbol, 1, 0) == 1 && symbol != '\n')
+    response.push_back(symbol);
+  return response;
+}
+
+/**
+ * Открывает соединение с сервером.
+ */
+static int connectServer() {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, SOCKET_PATH.c_str(), sizeof(address.sun_path) - 1);
+  int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (connect(connection, (struct sockaddr*)&address, sizeof(address)) != 0) {
+    close(connection);
+    return -1;
+  }
+  return connection;
+}
+
+TEST(WorkflowServer, ExecutesRequests) {
+  const std::string input = "._temp_test_server_in_";
+  const std::string output = "._temp_test_server_out_";
+  std::ofstream(input) << "ghi\nabc\ndef\n";
+
+  WorkflowServer server(SOCKET_PATH, 2);
+  std::thread thread(&WorkflowServer::run, &server);
+
+  int connection = connectServer();
+  ASSERT_GE(connection, 0);
+
+  ASSERT_EQ(request(connection, input, output, SORT_WORKFLOW), "OK");
+  ASSERT_EQ(request(connection, input, "", SORT_WORKFLOW).substr(0, 5),
+            "ERROR");
+  ASSERT_EQ(request(connection, input, output, "desc csed").substr(0, 5),
+            "ERROR");
+
+  close(connection);
+  server.stop();
+  thread.join();
+
+  std::ifstream result(output);
+  std::string line;
+  std::vector<std::string> lines;
+  while (std::getline(result, line))
+    lines.push_back(line);
+  ASSERT_EQ(lines, std::vector<std::string>({"abc", "def", "ghi"}));
+
+  remove(input.c_str());
+  remove(output.c_str());
+}
+
+TEST(WorkflowServer, SurvivesBadRequests) {
+  const std::string input = "._temp_test_server_in_";
+  const std::string output = "._temp_test_server_out_";
+  std::ofstream(input) << "b\na\n";
+
+  // Один поток пула: простаивающее соединение не должно его занимать
+  WorkflowServer server(SOCKET_PATH, 1);
+  std::thread thread(&WorkflowServer::run, &server);
+
+  int idle = connectServer();
+  ASSERT_GE(idle, 0);
+
+  int connection = connectServer();
+  ASSERT_GE(connection, 0);
+  const std::string huge = "in.txt\no.txt\n18446744073709551000\n";
+  send(connection, huge.data(), huge.size(), MSG_NOSIGNAL);
+  std::string response;
+  char symbol;
+  while (recv(connection, &symbol, 1, 0) == 1 && symbol != '\n')
+    response.push_back(symbol);
+  ASSERT_EQ(response, "ERROR Invalid workflow length.");
+  close(connection);
+
+  connection = connectServer();
+  ASSERT_GE(connection, 0);
+  ASSERT_EQ(request(connection, input, output, SORT_WORKFLOW), "OK");
+  ASSERT_EQ(request(connection, input, output, SORT_WORKFLOW), "OK");
+
+  close(connection);
+  close(idle);
+  server.stop();
+  thread.join();
+
+  remove(input.c_str());
+  remove(output.c_str());
+}
+
+TEST(WorkflowServer, LimitsSlowClients) {
+  const std::string input = "._temp_test_server_in_";
+  const std::string output = "._temp_test_server_out_";
+  std::ofstream(input) << "b\na\n";
+
+  WorkflowServer server(SOCKET_PATH, 1);
+  server.setRequestTimeout(1);
+  std::thread thread(&WorkflowServer::run, &server);
+
+  // Клиент присылает запрос по байту: каждое чтение укладывается в срок,
+  // но весь запрос - нет, и сервер закрывает соединение
+  int slow = connectServer();
+  ASSERT_GE(slow, 0);
+  const std::string data = input + "\n" + output + "\n";
+  const auto start = std::chrono::steady_clock::now();
+  bool closed = false;
+  for (size_t i = 0; i < 50 && !closed; i++) {
+    closed = send(slow, &data[i % data.size()], 1, MSG_NOSIGNAL) != 1;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  ASSERT_TRUE(closed);
+  ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(4));
+  close(slow);
+
+  // Единственный поток пула свободен для других запросов
+  int connection = connectServer();
+  ASSERT_GE(connection, 0);
+  ASSERT_EQ(request(connection, input, output, SORT_WORKFLOW), "OK");
+
+  close(connection);
+  server.stop();
+  thread.join();
+
+  remove(input.c_str());
+  remove(output.c_str());
+}
+
+TEST(WorkflowServer, KeepsForeignFiles) {
+  // Обычный файл по пути сокета не удаляется
+  std::ofstream(SOCKET_PATH) << "data\n";
+  ASSERT_THROW(WorkflowServer server(SOCKET_PATH, 1), ServerException);
+  std::ifstream kept(SOCKET_PATH);
+  std::string line;
+  ASSERT_TRUE(std::getline(kept, line));
+  ASSERT_EQ(line, "data");
+  remove(SOCKET_PATH.c_str());
+
+  // Сокет, который слушает другой сервер, тоже
+  WorkflowServer server(SOCKET_PATH, 1);
+  ASSERT_THROW(WorkflowServer other(SOCKET_PATH, 1), ServerException);
+  int connection = connectServer();
+  ASSERT_GE(connection, 0);
+  close(connection);
+}
@@ -0,0 +1,276 @@
+//
+//  test_streaming.cpp
+//  WorkflowTests
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "streaming.h"
+#include "workflow.h"
+
+using namespace wkfw;
+
+static const std::string STREAMING_INPUT = "._temp_test_streaming_in_";
+static const std::string STREAMING_OUTPUT_A = "._temp_test_streaming_a_";
+static const std::string STREAMING_OUTPUT_B = "._temp_test_streaming_b_";
+
+/**
+ * Бесконечный ленивый текст, считающий запрошенные части.
+ */
+class RepeatCursor : public Cursor {
+ public:
+  RepeatCursor(size_t& pulled) : pulled(pulled) {}
+
+  bool next(Text& batch) throw(WorkerExecuteException) override {
+    pulled++;
+    batch = WorkerResult(std::vector<std::string>({ "a", "b", "c" })).getValue();
+    return true;
+  }
+
+ private:
+  size_t& pulled;
+};
+
+/**
+ * Блок, пропускающий заданное количество частей входа, после чего
+ * памяти не хватает.
+ */
+class LimitedWorker : public Worker {
+ public:
+  LimitedWorker(const size_t identifier, const size_t parts)
+      : Worker(identifier, WorkerResult::TEXT, WorkerResult::TEXT),
+        parts(parts) {}
+
+  const WorkerResult execute(const WorkerResult& previous) const
+      throw(WorkerExecuteException) override {
+    return previous;
+  }
+
+  std::unique_ptr<Cursor> open(std::unique_ptr<Cursor> input,
+                               std::shared_ptr<MemoryBudget>) const
+      throw(WorkerExecuteException) override {
+    return std::unique_ptr<Cursor>(new LimitedCursor(std::move(input), parts));
+  }
+
+ private:
+  class LimitedCursor : public Cursor {
+   public:
+    LimitedCursor(std::unique_ptr<Cursor> input, const size_t parts)
+        : input(std::move(input)), parts(parts) {}
+
+    bool next(Text& batch) throw(WorkerExecuteException) override {
+      if (parts == 0)
+        throw MemoryLimitException();
+      parts--;
+      return input->next(batch);
+    }
+
+   private:
+    std::unique_ptr<Cursor> input;
+    size_t parts;
+  };
+
+  const size_t parts;
+};
+
+static std::vector<std::string> readLines(const std::string& filename) {
+  std::ifstream file(filename);
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(file, line))
+    lines.push_back(line);
+  return lines;
+}
+
+TEST(Streaming, BudgetRight) {
+  MemoryBudget budget(100);
+  ASSERT_TRUE(budget.reserve(60));
+  ASSERT_FALSE(budget.reserve(50));
+  ASSERT_EQ(budget.getAvailable(), 40);
+  budget.release(60);
+  ASSERT_EQ(budget.getUsed(), 0);
+
+  auto shared = std::make_shared<MemoryBudget>(8 << 20);
+  {
+    Arena arena(shared);
+    arena.allocate(10);
+    ASSERT_EQ(shared->getUsed(), arena.getSize());
+    ASSERT_THROW(arena.allocate(5 << 20), MemoryLimitException);
+    MemoryBudget::Reservation reservation(shared, 1 << 20);
+    ASSERT_THROW(MemoryBudget::Reservation(shared, 4 << 20),
+                 MemoryLimitException);
+  }
+  ASSERT_EQ(shared->getUsed(), 0);
+}
+
+TEST(Streaming, SortRunsRight) {
+  std::vector<std::string> first({ "b 2", "a 1", "c 3", "a 1" });
+  std::vector<std::string> second({ "a 1", "d 0", "b 2", "b 10" });
+  std::vector<std::string> all(first);
+  all.insert(all.end(), second.begin(), second.end());
+
+  for (auto collapse : { workers::Sort::Collapse::NONE,
+                         workers::Sort::Collapse::UNIQUE,
+                         workers::Sort::Collapse::COUNT }) {
+    for (auto order : { workers::Sort::Order::TEXT,
+                        workers::Sort::Order::NUMERIC }) {
+      workers::Sort sort(0, collapse, 2, order);
+      std::vector<std::FILE*> runs;
+      for (auto const& part : { first, second })
+        runs.push_back(sort.spill(sort.execute(WorkerResult(part)).getValue()));
+
+      // Слияние частей совпадает с сортировкой всего текста
+      std::vector<std::string> merged;
+      sort.mergeRuns(runs, [&merged](std::string& line) {
+        merged.push_back(line);
+        return true;
+      });
+      ASSERT_EQ(merged,
+                sort.execute(WorkerResult(all)).getValue().toStrings());
+
+      for (auto run : runs)
+        fclose(run);
+    }
+  }
+}
+
+TEST(Streaming, WorkflowRight) {
+  {
+    std::ofstream input(STREAMING_INPUT);
+    for (size_t i = 0; i < 1200000; i++)
+      input << i * 7919 % 1000003 << "\n";
+  }
+  const std::string text = "desc 1 = grep 7 2 = sort count 3 = replace 7 x "
+                           "csed 1 -> 2 -> 3";
+
+  std::istringstream unlimited(text);
+  Workflow(unlimited, STREAMING_INPUT, STREAMING_OUTPUT_A).execute();
+
+  // Вход не помещается в ограничение: схема исполняется потоково,
+  // сортировка сбрасывает части на диск
+  auto budget = std::make_shared<MemoryBudget>(16 << 20);
+  std::istringstream limited(text);
+  Workflow streaming(limited, STREAMING_INPUT, STREAMING_OUTPUT_B);
+  streaming.setMemoryBudget(budget);
+  streaming.execute();
+  ASSERT_EQ(budget->getUsed(), 0);
+
+  const std::vector<std::string> expected = readLines(STREAMING_OUTPUT_A);
+  ASSERT_GT(expected.size(), 1000);
+  ASSERT_EQ(readLines(STREAMING_OUTPUT_B), expected);
+
+  // Схема, которую нельзя исполнить потоково, упирается в ограничение
+  std::istringstream whole("desc 1 = uniq 2 = sort csed 1 -> 2");
+  Workflow inMemory(whole, STREAMING_INPUT, STREAMING_OUTPUT_B);
+  inMemory.setMemoryBudget(budget);
+  ASSERT_THROW(inMemory.execute(), WorkerExecuteException);
+  ASSERT_EQ(budget->getUsed(), 0);
+
+  remove(STREAMING_INPUT.c_str());
+  remove(STREAMING_OUTPUT_A.c_str());
+  remove(STREAMING_OUTPUT_B.c_str());
+}
+
+TEST(Streaming, LazyRight) {
+  // head запрашивает части, только пока не набрано нужное количество строк
+  size_t pulled = 0;
+  workers::Head head(0, 5);
+  auto cursor = head.open(
+      std::unique_ptr<Cursor>(new RepeatCursor(pulled)), nullptr);
+  std::vector<std::string> lines;
+  Text batch;
+  while (cursor->next(batch))
+    for (auto const& line : batch)
+      lines.push_back(line.str());
+  ASSERT_EQ(lines, std::vector<std::string>({ "a", "b", "c", "a", "b" }));
+  ASSERT_EQ(pulled, 2);
+
+  // Файл из нескольких блоков чтения, строка длиннее блока
+  // и последняя строка без переноса
+  {
+    std::ofstream input(STREAMING_INPUT);
+    for (size_t i = 0; i < 600000; i++) {
+      input << "row " << i * 7919 % 1000003 << "\n";
+      if (i == 300000)
+        input << std::string(5 << 20, 'x') << "\n";
+    }
+    input << "row 77";
+  }
+
+  workers::ReadFile reader(0, STREAMING_INPUT);
+  workers::Grep grep(1, "7");
+  workers::Sort sort(2);
+  workers::Replace replace(3, "7", "x");
+  workers::Head first(4, 1000);
+  workers::WriteFile writer(5, STREAMING_OUTPUT_A);
+
+  const Text text = reader.execute(WorkerResult()).getValue();
+  ASSERT_EQ(text.size(), 600002);
+  const WorkerResult grepped = grep.execute(WorkerResult(text.toStrings()));
+  const WorkerResult sorted = sort.execute(grepped);
+  const WorkerResult replaced = replace.execute(sorted);
+
+  executeLazy({ &reader, &grep, &writer }, nullptr);
+  ASSERT_EQ(readLines(STREAMING_OUTPUT_A), grepped.getValue().toStrings());
+
+  executeLazy({ &reader, &grep, &sort, &replace, &first, &writer }, nullptr);
+  std::vector<std::string> expected = replaced.getValue().toStrings();
+  expected.resize(1000);
+  ASSERT_EQ(readLines(STREAMING_OUTPUT_A), expected);
+
+  // Схема целиком исполняется так же, с учетом памяти
+  auto budget = std::make_shared<MemoryBudget>(1 << 30);
+  std::istringstream scheme("desc 1 = grep x csed 1");
+  Workflow workflow(scheme, STREAMING_INPUT, STREAMING_OUTPUT_B);
+  workflow.setMemoryBudget(budget);
+  workflow.execute();
+  ASSERT_EQ(readLines(STREAMING_OUTPUT_B),
+            std::vector<std::string>({ std::string(5 << 20, 'x') }));
+  ASSERT_EQ(budget->getUsed(), 0);
+
+  remove(STREAMING_INPUT.c_str());
+  remove(STREAMING_OUTPUT_A.c_str());
+  remove(STREAMING_OUTPUT_B.c_str());
+}
+
+TEST(Streaming, LazyLimitAfterOutput) {
+  {
+    std::ofstream input(STREAMING_INPUT);
+    input << "a\nb\n";
+  }
+  workers::ReadFile reader(0, STREAMING_INPUT);
+  workers::WriteFile writer(2, workers::STANDARD_STREAM);
+
+  // Память кончилась до записи: схему можно исполнить заново
+  LimitedWorker before(1, 0);
+  ASSERT_THROW(executeLazy({ &reader, &before, &writer }, nullptr),
+               MemoryLimitException);
+
+  // Первая часть уже выведена: повторное исполнение вывело бы ее дважды
+  LimitedWorker after(1, 1);
+  std::ostringstream output;
+  std::streambuf* standard = std::cout.rdbuf(output.rdbuf());
+  bool limited = false;
+  std::string error;
+  try {
+    executeLazy({ &reader, &after, &writer }, nullptr);
+  } catch (const MemoryLimitException&) {
+    limited = true;
+  } catch (const WorkerExecuteException& e) {
+    error = e.what();
+  }
+  std::cout.rdbuf(standard);
+  ASSERT_FALSE(limited);
+  ASSERT_EQ(error, MemoryLimitException().what());
+  ASSERT_EQ(output.str(), "a\nb\n");
+
+  remove(STREAMING_INPUT.c_str());
+}
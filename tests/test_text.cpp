@@ -0,0 +1,201 @@
+//
+//  test_text.cpp
+//  WorkflowTests
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include "text.h"
+
+using namespace wkfw;
+
+TEST(Text, ArenaRight) {
+  Arena arena;
+  ASSERT_EQ(arena.getSize(), 0);
+
+  char* first = arena.allocate(10);
+  char* second = arena.allocate(10);
+  ASSERT_EQ(second, first + 10);
+
+  // Большой участок получает отдельный кусок и не прерывает текущий
+  const size_t huge = 16 << 20;
+  char* large = arena.allocate(huge);
+  memset(large, 'x', huge);
+  ASSERT_EQ(arena.allocate(10), second + 10);
+
+  // Параллельные выделения не пересекаются
+  std::vector<char*> blocks(4000);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; t++)
+    threads.push_back(std::thread([&arena, &blocks, t] {
+      for (size_t i = t; i < blocks.size(); i += 4) {
+        blocks[i] = arena.allocate(100);
+        memset(blocks[i], (int)t, 100);
+      }
+    }));
+  for (auto& thread : threads)
+    thread.join();
+  std::sort(blocks.begin(), blocks.end());
+  for (size_t i = 1; i < blocks.size(); i++)
+    ASSERT_GE(blocks[i] - blocks[i - 1], 100);
+}
+
+TEST(Text, ArenaResizeRight) {
+  Arena arena;
+
+  // Последний участок продолжается на месте
+  char* block = arena.allocate(10);
+  memcpy(block, "0123456789", 10);
+  ASSERT_EQ(arena.resize(block, 10, 100), block);
+
+  // Иначе содержимое переносится в новый участок
+  arena.allocate(1);
+  char* moved = arena.resize(block, 100, 200);
+  ASSERT_NE(moved, block);
+  ASSERT_EQ(memcmp(moved, "0123456789", 10), 0);
+
+  // Отдельный кусок переотображается
+  const size_t huge = 8 << 20;
+  char* large = arena.allocate(huge);
+  memset(large, 'x', huge);
+  large = arena.resize(large, huge, 2 * huge);
+  ASSERT_EQ(large[huge - 1], 'x');
+  memset(large + huge, 'y', huge);
+}
+
+TEST(Text, FindRight) {
+  const std::string text = "abcabd xyz";
+  ASSERT_EQ(findBytes(text.data(), text.size(), "abd"), text.data() + 3);
+  ASSERT_EQ(findBytes(text.data(), text.size(), "a"), text.data());
+  ASSERT_EQ(findBytes(text.data(), text.size(), ""), text.data());
+  ASSERT_EQ(findBytes(text.data(), text.size(), "xyz!"), nullptr);
+  ASSERT_EQ(findBytes(text.data(), 9, "xyz"), nullptr);
+
+  const Line line(text);
+  ASSERT_EQ(line.find("ab"), 0);
+  ASSERT_EQ(line.find("ab", 1), 3);
+  ASSERT_EQ(line.find("ab", 11), std::string::npos);
+}
+
+TEST(Text, BuilderRight) {
+  TextBuilder builder;
+  builder.add("abc");
+  builder.add("");
+  builder.add(std::string(100000, 'z'));
+  const Text text = builder.build();
+
+  ASSERT_EQ(text.size(), 3);
+  ASSERT_FALSE(text.isSelection());
+  ASSERT_EQ(text[0].str(), "abc");
+  ASSERT_EQ(text[1].size, 0);
+  ASSERT_EQ(text[2].size, 100000);
+  ASSERT_EQ(text[0].find("c"), 2);
+  ASSERT_EQ(text[0].find("c", 3), std::string::npos);
+  ASSERT_TRUE(text[0] < text[2]);
+  ASSERT_TRUE(builder.build().empty());
+
+  // Байты строк лежат подряд, каждая строка завершена переносом
+  const TextColumn* column = text.getColumn();
+  ASSERT_TRUE(column->isTerminated());
+  ASSERT_EQ(column->getLength(), 100006);
+  ASSERT_EQ(std::string(column->getBytes(), 6), "abc\n\nz");
+  ASSERT_EQ(column->findLine(4), 1);
+  ASSERT_EQ(column->findLine(5, 1), 2);
+
+  // Содержимое файла делится на строки на месте, перенос в конце
+  // не начинает новую строку
+  const std::string file = "a\n\nbc\nd";
+  memcpy(builder.reserveBytes(file.size()), file.data(), file.size());
+  builder.addLines(file.size());
+  memcpy(builder.reserveBytes(3), "e\nf", 3);
+  builder.addLines(2);
+  const Text lines = builder.build();
+  ASSERT_EQ(lines.toStrings(),
+            std::vector<std::string>({ "a", "", "bc", "d", "e" }));
+  ASSERT_FALSE(lines.getColumn()->isTerminated());
+}
+
+TEST(Text, SelectionRight) {
+  TextBuilder source;
+  for (auto const& line : { "first", "second", "third" })
+    source.add(line);
+  const Text text = source.build();
+
+  // Строки одного столбца образуют выборку, строки не копируются
+  TextBuilder builder;
+  builder.keep(text, 2);
+  builder.keep(text, 0);
+  const Text selected = builder.build();
+  ASSERT_TRUE(selected.isSelection());
+  ASSERT_EQ(selected.getColumn(), text.getColumn());
+  ASSERT_EQ(selected[0].data, text[2].data);
+  ASSERT_EQ(selected.toStrings(),
+            std::vector<std::string>({ "third", "first" }));
+
+  // Выборка из выборки ссылается на тот же столбец, все строки
+  // столбца подряд - сам столбец
+  builder.keep(selected, 1);
+  ASSERT_EQ(builder.build()[0].data, text[0].data);
+  builder.append(text);
+  const Text whole = builder.build();
+  ASSERT_FALSE(whole.isSelection());
+  ASSERT_EQ(whole, text);
+
+  // Строки другого столбца копируются вместе с уже отобранными,
+  // копии переживают исходные тексты
+  Text joined;
+  {
+    TextBuilder other;
+    other.add("other");
+    const Text second = other.build();
+    builder.keep(text, 1);
+    builder.append(second);
+    builder.add("new");
+    joined = builder.build();
+  }
+  ASSERT_FALSE(joined.isSelection());
+  ASSERT_NE(joined.getColumn(), text.getColumn());
+  ASSERT_EQ(joined.toStrings(),
+            std::vector<std::string>({ "second", "other", "new" }));
+}
+
+TEST(Text, CompactionRight) {
+  auto arena = std::make_shared<Arena>();
+  TextBuilder source(arena);
+  for (size_t i = 0; i < 100; i++)
+    source.add("line " + std::to_string(i));
+  const Text text = source.build();
+
+  // Малая часть столбца из той же арены остается выборкой
+  TextBuilder builder(arena);
+  builder.keep(text, 7);
+  builder.keep(text, 3);
+  const Text shared = builder.build();
+  ASSERT_TRUE(shared.isSelection());
+  ASSERT_FALSE(shared.isOrdered());
+
+  // Малая часть столбца другой арены копируется, чтобы не удерживать его
+  TextBuilder other;
+  other.keep(text, 3);
+  other.keep(text, 7);
+  const Text compacted = other.build();
+  ASSERT_FALSE(compacted.isSelection());
+  ASSERT_NE(compacted.getColumn(), text.getColumn());
+  ASSERT_EQ(compacted.toStrings(),
+            std::vector<std::string>({ "line 3", "line 7" }));
+
+  // Большая часть остается выборкой
+  for (size_t i = 0; i < text.size(); i += 2)
+    other.keep(text, i);
+  const Text half = other.build();
+  ASSERT_TRUE(half.isSelection());
+  ASSERT_TRUE(half.isOrdered());
+  ASSERT_EQ(half.getColumn(), text.getColumn());
+}
@@ -8,9 +8,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <set>
 #include <fstream>
+#include <iostream>
+#include <sstream>
 
 #include "workers.h"
 
@@ -18,6 +21,16 @@ using namespace wkfw;
 
 const std::string TEMP_TEST_FILE = "._temp_test_";
 
+/**
+ * Создает текст из строк.
+ */
+static Text makeText(const std::vector<std::string>& lines) {
+  TextBuilder text;
+  for (auto const& line : lines)
+    text.add(line);
+  return text.build();
+}
+
 /**
  * Общий класс для тестирования работы с файлами.
  * Предоставляет методы для создания/удаления/проверки наличия файла.
@@ -96,6 +109,24 @@ TEST_F(IOWorkerTest, ReadFileRight) {
             WorkerResult({ "abc", "def", "ghi" }));
 }
 
+TEST_F(IOWorkerTest, ReadFromRight) {
+  workers::ReadFile read(0, TEMP_TEST_FILE);
+  uint64_t end;
+  
+  createFile(TEMP_TEST_FILE, "abc\ndef\ngh");
+  
+  ASSERT_EQ(read.readFrom(0, end), WorkerResult({ "abc", "def" }));
+  ASSERT_EQ(end, 8);
+  
+  ASSERT_EQ(read.readFrom(4, end), WorkerResult({ "def" }));
+  ASSERT_EQ(end, 8);
+  
+  ASSERT_EQ(read.readFrom(8, end), WorkerResult(std::vector<std::string>()));
+  ASSERT_EQ(end, 8);
+  
+  ASSERT_THROW(read.readFrom(100, end), WorkerExecuteException);
+}
+
 TEST_F(IOWorkerTest, WriteFileRight) {
   workers::WriteFile write(0, TEMP_TEST_FILE);
   
@@ -115,6 +146,37 @@ TEST(Workers, GrepRight) {
   
   ASSERT_EQ(grep.execute(WorkerResult({ "vwx def ghi", "jkl mno", "pqr stu yz" })),
             WorkerResult(std::vector<std::string>()));
+
+  // Вхождение не переходит через конец строки, результат - выборка
+  // из столбца входа
+  workers::Grep wide(0, "c\nd");
+  const WorkerResult input({ "abc", "de", "c", "xc\nd" });
+  const WorkerResult found = wide.execute(input);
+  ASSERT_EQ(found, WorkerResult({ "xc\nd" }));
+  ASSERT_TRUE(found.getValue().isSelection());
+  ASSERT_EQ(found.getValue().getColumn(), input.getValue().getColumn());
+
+  // Плотная и редкая выборки фильтруются без копирования строк
+  auto arena = std::make_shared<Arena>();
+  TextBuilder builder(arena);
+  std::vector<std::string> lines;
+  for (size_t i = 0; i < 1000; i++) {
+    lines.push_back(std::to_string(i));
+    builder.add(lines.back());
+  }
+  const WorkerResult all = WorkerResult(builder.build()).withArena(arena);
+  for (auto const& first : { "1", "99" }) {
+    const WorkerResult selected =
+        workers::Grep(0, first).execute(all).withArena(arena);
+    const WorkerResult filtered = workers::Grep(0, "5").execute(selected);
+    std::vector<std::string> expected;
+    for (auto const& line : lines)
+      if (line.find(first) != std::string::npos &&
+          line.find("5") != std::string::npos)
+        expected.push_back(line);
+    ASSERT_EQ(filtered.getValue().toStrings(), expected);
+    ASSERT_EQ(filtered.getValue().getColumn(), all.getValue().getColumn());
+  }
 }
 
 TEST(Workers, SortRight) {
@@ -130,6 +192,216 @@ TEST(Workers, SortRight) {
             WorkerResult({ "abc", "def", "ghi" }));
 }
 
+TEST(Workers, SortCollapseRight) {
+  workers::Sort unique(0, workers::Sort::Collapse::UNIQUE);
+  workers::Sort count(0, workers::Sort::Collapse::COUNT);
+  
+  ASSERT_EQ(unique.execute(WorkerResult({ "b", "a", "b", "a", "c" })),
+            WorkerResult({ "a", "b", "c" }));
+  
+  ASSERT_EQ(count.execute(WorkerResult({ "b", "a", "b", "b", "" })),
+            WorkerResult({ "1\t", "1\ta", "3\tb" }));
+  
+  ASSERT_EQ(count.merge(makeText({ "1\ta", "3\tb" }),
+                        makeText({ "2\tb", "1\tc" })).toStrings(),
+            std::vector<std::string>({ "1\ta", "5\tb", "1\tc" }));
+  
+  ASSERT_EQ(unique.merge(makeText({ "a", "b" }),
+                         makeText({ "b", "c" })).toStrings(),
+            std::vector<std::string>({ "a", "b", "c" }));
+}
+
+TEST(Workers, TopRight) {
+  workers::Top top(0, 3);
+  
+  ASSERT_EQ(top.execute(WorkerResult(std::vector<std::string>())),
+            WorkerResult(std::vector<std::string>()));
+  
+  ASSERT_EQ(top.execute(WorkerResult({ "e", "b", "d", "a", "c", "a" })),
+            WorkerResult({ "a", "a", "b" }));
+  
+  ASSERT_EQ(top.execute(WorkerResult({ "b", "a" })),
+            WorkerResult({ "a", "b" }));
+  
+  ASSERT_EQ(workers::Top(0, 0).execute(WorkerResult({ "a" })),
+            WorkerResult(std::vector<std::string>()));
+  
+  // Совпадает с началом результата полной сортировки
+  std::vector<std::string> text;
+  for (size_t i = 0; i < 200000; i++)
+    text.push_back(std::to_string(i * 7919 % 200003));
+  std::vector<std::string> sorted = text;
+  std::sort(sorted.begin(), sorted.end());
+  sorted.resize(100);
+  ASSERT_EQ(workers::Top(0, 100).execute(WorkerResult(text)),
+            WorkerResult(std::move(sorted)));
+}
+
+TEST(Workers, HeadTailRight) {
+  ASSERT_EQ(workers::Head(0, 2).execute(WorkerResult({ "a", "b", "c" })),
+            WorkerResult({ "a", "b" }));
+  ASSERT_EQ(workers::Tail(0, 2).execute(WorkerResult({ "a", "b", "c" })),
+            WorkerResult({ "b", "c" }));
+  ASSERT_EQ(workers::Tail(0, 5).execute(WorkerResult({ "a" })),
+            WorkerResult({ "a" }));
+  ASSERT_EQ(workers::constructWorker(0, "head", {}), nullptr);
+}
+
+TEST(Workers, FieldIndexRight) {
+  FieldIndex index(makeText({ "  a\tbc  d ", "", "x" }));
+  
+  ASSERT_EQ(index.getCount(0), 3);
+  ASSERT_EQ(index.getCount(1), 0);
+  ASSERT_EQ(index.getField(0, 2).begin, 4);
+  ASSERT_EQ(index.getField(0, 2).end, 6);
+  ASSERT_EQ(index.getField(0, 4).size(), 0);
+  ASSERT_EQ(index.getField(2, 1).size(), 1);
+  
+  FieldSpan span = FieldIndex::findField("  a\tbc  d ", 11, 3);
+  ASSERT_EQ(span.begin, 8);
+  ASSERT_EQ(span.end, 9);
+}
+
+TEST(Workers, FieldWorkersRight) {
+  WorkerResult text({ "10:01 host1 ERROR disk", "10:02 host2 INFO ok",
+                      "10:00 host3 ERROR net", "short" });
+  workers::Cut cut(0, { 3, 1, 4 });
+  workers::FieldGrep grep(0, 3, "ERR");
+  
+  ASSERT_EQ(cut.execute(text),
+            WorkerResult({ "ERROR\t10:01\tdisk", "INFO\t10:02\tok",
+                           "ERROR\t10:00\tnet", "\tshort\t" }));
+  ASSERT_EQ(grep.execute(text),
+            WorkerResult({ "10:01 host1 ERROR disk", "10:00 host3 ERROR net" }));
+  
+  // Порции по одной строке совпадают с обработкой всего текста
+  TextBuilder cutLines;
+  TextBuilder grepLines;
+  workers::FieldGrep none(0, 2, "host1 ");
+  for (size_t i = 0; i < text.getValue().size(); i++) {
+    cut.processBatch(text, i, i + 1, cutLines);
+    none.processBatch(text, i, i + 1, grepLines);
+  }
+  ASSERT_EQ(WorkerResult(cutLines.build()), cut.execute(text));
+  ASSERT_TRUE(grepLines.build().empty());
+  
+  ASSERT_EQ(workers::constructWorker(0, "cut", { "0" }), nullptr);
+  ASSERT_EQ(workers::constructWorker(0, "cut", { "3-1" }), nullptr);
+}
+
+TEST(Workers, SortByFieldRight) {
+  workers::Sort sort(0, workers::Sort::Collapse::NONE, 2);
+  
+  ASSERT_EQ(sort.execute(WorkerResult({ "a 3", "b 1", "c", "a 2", "0 1" })),
+            WorkerResult({ "c", "0 1", "b 1", "a 2", "a 3" }));
+  
+  workers::Sort count(0, workers::Sort::Collapse::COUNT, 2);
+  ASSERT_EQ(count.execute(WorkerResult({ "b 1", "a 2", "b 1" })),
+            WorkerResult({ "2\tb 1", "1\ta 2" }));
+  ASSERT_EQ(count.merge(makeText({ "2\tb 1", "1\ta 2" }),
+                        makeText({ "1\tz 1", "1\ta 2" })).toStrings(),
+            std::vector<std::string>({ "2\tb 1", "1\tz 1", "2\ta 2" }));
+  
+  ASSERT_EQ(workers::constructWorker(0, "sort", { "by" }), nullptr);
+  ASSERT_EQ(workers::constructWorker(0, "sort", { "unique", "count" }), nullptr);
+}
+
+TEST(Workers, SortOrdersRight) {
+  workers::Sort numeric(0, workers::Sort::Collapse::NONE, 0,
+                        workers::Sort::Order::NUMERIC);
+  ASSERT_EQ(numeric.execute(WorkerResult({ "10", "9", "-2.5", "x", "0.5",
+                                           "-10", " 3 apples", "9" })),
+            WorkerResult({ "-10", "-2.5", "x", "0.5", " 3 apples", "9", "9",
+                           "10" }));
+  
+  workers::Sort human(0, workers::Sort::Collapse::NONE, 2,
+                      workers::Sort::Order::HUMAN);
+  ASSERT_EQ(human.execute(WorkerResult({ "a 1G", "b 2K", "c 900", "d 1.5M",
+                                         "e 3k" })),
+            WorkerResult({ "c 900", "b 2K", "e 3k", "d 1.5M", "a 1G" }));
+  
+  workers::Sort version(0, workers::Sort::Collapse::UNIQUE, 0,
+                        workers::Sort::Order::VERSION);
+  ASSERT_EQ(version.execute(WorkerResult({ "1.10", "1.9", "1.09.1", "1.10",
+                                           "1.2b", "1.2a", "2" })),
+            WorkerResult({ "1.2a", "1.2b", "1.9", "1.09.1", "1.10", "2" }));
+  
+  // Последовательности цифр длиннее 255 сравниваются как числа
+  const std::string longer = "v" + std::string(256, '1');
+  const std::string shorter = "v" + std::string(255, '9');
+  const std::string longest = "v" + std::string(70000, '1');
+  ASSERT_EQ(version.execute(WorkerResult({ longest, longer, shorter })),
+            WorkerResult({ shorter, longer, longest }));
+  ASSERT_EQ(version.merge(makeText({ shorter, longest }),
+                          makeText({ longer })).toStrings(),
+            std::vector<std::string>({ shorter, longer, longest }));
+  
+  // Слияние упорядочивает так же, как сортировка
+  ASSERT_EQ(numeric.merge(makeText({ "2", "10" }),
+                          makeText({ "3", "11" })).toStrings(),
+            std::vector<std::string>({ "2", "3", "10", "11" }));
+  ASSERT_EQ(version.merge(makeText({ "1.9", "1.10" }),
+                          makeText({ "1.10", "1.11" })).toStrings(),
+            std::vector<std::string>({ "1.9", "1.10", "1.11" }));
+  
+  // Большой ввод совпадает со сравнением чисел
+  std::vector<std::string> text;
+  for (size_t i = 0; i < 10000; i++)
+    text.push_back(std::to_string((long)(i * 7919 % 10007) - 5000));
+  WorkerResult sorted = numeric.execute(WorkerResult(text));
+  for (size_t i = 1; i < sorted.getValue().size(); i++)
+    ASSERT_LE(std::stol(sorted.getValue()[i - 1].str()),
+              std::stol(sorted.getValue()[i].str()));
+}
+
+TEST(Workers, AggregateRight) {
+  WorkerResult text({ "host1 GET 10", "host2 GET 5", "host1 POST 2.5",
+                      "host3 GET x", "lonely", "host2 PUT -1" });
+  typedef workers::Aggregate::Operation Operation;
+  
+  ASSERT_EQ(workers::Aggregate(0, 1, Operation::COUNT, 0).execute(text),
+            WorkerResult({ "host1\t2", "host2\t2", "host3\t1", "lonely\t1" }));
+  ASSERT_EQ(workers::Aggregate(0, 1, Operation::SUM, 3).execute(text),
+            WorkerResult({ "host1\t12.5", "host2\t4" }));
+  ASSERT_EQ(workers::Aggregate(0, 2, Operation::MIN, 3).execute(text),
+            WorkerResult({ "GET\t5", "POST\t2.5", "PUT\t-1" }));
+  ASSERT_EQ(workers::Aggregate(0, 1, Operation::MAX, 3).execute(text),
+            WorkerResult({ "host1\t10", "host2\t5" }));
+  
+  ASSERT_EQ(workers::constructWorker(0, "aggregate", { "1", "sum" }), nullptr);
+  ASSERT_EQ(workers::constructWorker(0, "aggregate", { "1", "avg", "2" }),
+            nullptr);
+}
+
+TEST(Workers, AggregateSpillRight) {
+  std::vector<std::string> text;
+  for (size_t i = 0; i < 200000; i++)
+    text.push_back("key" + std::to_string(i % 5000) + " " + std::to_string(i));
+  typedef workers::Aggregate::Operation Operation;
+  
+  // С крошечным бюджетом группы многократно сбрасываются на диск
+  WorkerResult inMemory =
+      workers::Aggregate(0, 1, Operation::SUM, 2).execute(WorkerResult(text));
+  WorkerResult spilled =
+      workers::Aggregate(0, 1, Operation::SUM, 2, 1).execute(WorkerResult(text));
+  
+  ASSERT_EQ(inMemory.getValue().size(), 5000);
+  ASSERT_EQ(inMemory, spilled);
+  
+  // Разделы с множеством групп не помещаются в бюджет и при слиянии
+  // делятся на разделы следующего уровня
+  text.clear();
+  for (size_t i = 0; i < 400000; i++)
+    text.push_back("key" + std::to_string(i * 7919 % 300007));
+  inMemory =
+      workers::Aggregate(0, 1, Operation::COUNT, 0).execute(WorkerResult(text));
+  spilled = workers::Aggregate(0, 1, Operation::COUNT, 0, 0)
+                .execute(WorkerResult(text));
+  
+  ASSERT_EQ(inMemory.getValue().size(), 300007);
+  ASSERT_EQ(inMemory, spilled);
+}
+
 TEST(Workers, ReplaceRight) {
   workers::Replace replace(0, "abc", "def");
   
@@ -158,6 +430,232 @@ TEST(Workers, ReplaceRight) {
             WorkerResult({ "def def def" }));
 }
 
+TEST(Workers, UniqRight) {
+  workers::Uniq uniq(0);
+  
+  ASSERT_EQ(uniq.execute(WorkerResult(std::vector<std::string>())),
+            WorkerResult(std::vector<std::string>()));
+  
+  ASSERT_EQ(uniq.execute(WorkerResult({ "b", "a", "b", "", "a", "" })),
+            WorkerResult({ "b", "a", "" }));
+  
+  std::vector<std::string> text;
+  for (size_t i = 0; i < 1000; i++)
+    text.push_back(std::to_string(i % 100));
+  WorkerResult result = uniq.execute(WorkerResult(text));
+  ASSERT_EQ(result.getValue().size(), 100);
+  ASSERT_EQ(result.getValue().front().str(), "0");
+  ASSERT_EQ(result.getValue().back().str(), "99");
+}
+
+TEST(Workers, ApproxUniqRight) {
+  workers::ApproxUniq uniq(0, 0);
+  
+  ASSERT_EQ(uniq.execute(WorkerResult({ "b", "a", "b", "", "a", "" })),
+            WorkerResult({ "b", "a", "" }));
+  
+  // Повторы всегда отбрасываются, уникальные строки - почти всегда сохраняются
+  std::vector<std::string> text;
+  for (size_t i = 0; i < 20000; i++)
+    text.push_back("line " + std::to_string(i % 10000));
+  size_t count = workers::ApproxUniq(0, 10000).execute(WorkerResult(text)).getValue().size();
+  ASSERT_LE(count, 10000);
+  ASSERT_GE(count, 9700);
+  
+  ASSERT_EQ(workers::constructWorker(0, "approxuniq", { "x" }), nullptr);
+}
+
+TEST(Workers, LineWorkersRight) {
+  workers::Grep grep(0, "abc");
+  workers::Replace replace(0, "abc", "def");
+  const WorkerResult sample({ "xabcx", "xyz", "abcabc" });
+  
+  const Text replaced =
+      workers::applyLineWorkers({ &grep, &replace }, sample.getValue(), nullptr);
+  ASSERT_EQ(replaced.toStrings(),
+            std::vector<std::string>({ "xdefx", "defdef" }));
+  ASSERT_TRUE(
+      workers::applyLineWorkers({ &replace, &grep }, sample.getValue(), nullptr)
+          .empty());
+
+  // Порции произвольных границ дают тот же результат, что и весь текст,
+  // обработанный порциями по BATCH_LINES
+  std::vector<std::string> lines;
+  std::vector<std::string> expected;
+  for (size_t i = 0; i < 10000; i++) {
+    lines.push_back("line " + std::to_string(i * 7919 % 10007));
+    if (lines.back().find("77") != std::string::npos)
+      expected.push_back(lines.back());
+  }
+  const WorkerResult text(lines);
+  workers::Grep sevens(0, "77");
+  ASSERT_EQ(sevens.execute(text).getValue().toStrings(), expected);
+
+  TextBuilder output;
+  sevens.processBatch(text, 0, 3, output);
+  sevens.processBatch(text, 3, 3, output);
+  sevens.processBatch(text, 3, 5000, output);
+  sevens.processBatch(text, 5000, lines.size(), output);
+  ASSERT_EQ(output.build().toStrings(), expected);
+}
+
+TEST_F(IOWorkerTest, ScanRight) {
+  workers::ReadFile read(0, TEMP_TEST_FILE);
+  std::vector<std::string> lines;
+  auto collect = [&](std::string& line) {
+    lines.push_back(line);
+    return lines.size() < 3;
+  };
+  
+  createFile(TEMP_TEST_FILE, "a\n\nb\nc\nd");
+  read.scan(collect);
+  ASSERT_EQ(lines, std::vector<std::string>({ "a", "", "b" }));
+  
+  lines.clear();
+  read.scan(collect, true);
+  ASSERT_EQ(lines, std::vector<std::string>({ "d", "c", "b" }));
+  
+  // Строки длиннее блока чтения и перенос строки в конце файла
+  std::string text;
+  for (size_t i = 0; i < 30000; i++)
+    text += std::to_string(i) + "\n";
+  createFile(TEMP_TEST_FILE, text);
+  lines.clear();
+  read.scan(collect, true);
+  ASSERT_EQ(lines, std::vector<std::string>({ "29999", "29998", "29997" }));
+  
+  std::vector<std::string> all;
+  read.scan([&](std::string& line) { all.push_back(line); return true; }, true);
+  std::reverse(all.begin(), all.end());
+  ASSERT_EQ(WorkerResult(std::move(all)), read.execute(WorkerResult()));
+}
+
+TEST_F(IOWorkerTest, JoinRight) {
+  workers::Join join(0, TEMP_TEST_FILE, 2);
+  createFile(TEMP_TEST_FILE, "host1 dc-east rack 4\n  host2\tdc-west\nhost1 dup\nempty");
+  
+  ASSERT_EQ(join.execute(WorkerResult({ "GET host1 /", "GET host3 /",
+                                        "PUT host2", "GET", "GET empty" })),
+            WorkerResult({ "GET host1 /\tdc-east rack 4", "PUT host2\tdc-west",
+                           "GET empty\t" }));
+  
+  // Пустой файл соответствий
+  createFile(TEMP_TEST_FILE, "");
+  ASSERT_EQ(join.execute(WorkerResult({ "GET host1 /" })),
+            WorkerResult(std::vector<std::string>()));
+  
+  removeFile(TEMP_TEST_FILE);
+  ASSERT_THROW(join.execute(WorkerResult({ "a" })), WorkerExecuteException);
+  ASSERT_EQ(join.getFingerprint(), "");
+}
+
+TEST_F(IOWorkerTest, MultiFileRight) {
+  const std::string second = TEMP_TEST_FILE + "2";
+  const std::string third = TEMP_TEST_FILE + "3";
+  createFile(TEMP_TEST_FILE, "b\nd\nf");
+  createFile(second, "a\nd\ng\n");
+  createFile(third, "c");
+  
+  workers::ReadFile concat(0, { third, TEMP_TEST_FILE + "?" });
+  ASSERT_EQ(concat.getFilenames(),
+            std::vector<std::string>({ third, second, third }));
+  ASSERT_EQ(concat.execute(WorkerResult()),
+            WorkerResult({ "c", "a", "d", "g", "c" }));
+  ASSERT_FALSE(concat.isSingleFile());
+  ASSERT_NE(concat.getFingerprint(), "");
+  
+  std::vector<std::string> lines;
+  concat.scan([&](std::string& line) { lines.push_back(line); return true; }, true);
+  ASSERT_EQ(lines, std::vector<std::string>({ "c", "g", "d", "a", "c" }));
+  
+  workers::ReadFile merge(0, { TEMP_TEST_FILE, second, third },
+                          workers::ReadFile::Mode::MERGE);
+  ASSERT_EQ(merge.execute(WorkerResult()),
+            WorkerResult({ "a", "b", "c", "d", "d", "f", "g" }));
+  
+  // Порядок файлов не определен, но каждый файл идет целиком
+  workers::ReadFile interleave(0, { TEMP_TEST_FILE, second },
+                               workers::ReadFile::Mode::INTERLEAVE);
+  const WorkerResult result = interleave.execute(WorkerResult());
+  ASSERT_TRUE(result == WorkerResult({ "b", "d", "f", "a", "d", "g" }) ||
+              result == WorkerResult({ "a", "d", "g", "b", "d", "f" }));
+  ASSERT_EQ(interleave.getFingerprint(), "");
+  
+  // Большие файлы чередуются блоками по 1 МиБ: строки каждого файла идут
+  // в своем порядке, а переходов между файлами не больше, чем блоков
+  std::string first;
+  std::string other;
+  std::vector<std::string> firstLines;
+  std::vector<std::string> otherLines;
+  for (size_t i = 0; i < 300000; i++) {
+    firstLines.push_back("b" + std::to_string(i));
+    otherLines.push_back("a" + std::to_string(i));
+    first += firstLines.back() + "\n";
+    other += otherLines.back() + "\n";
+  }
+  createFile(TEMP_TEST_FILE, first);
+  createFile(second, other);
+  const wkfw::Text blocks = interleave.execute(WorkerResult()).getValue();
+  std::vector<std::string> fromFirst;
+  std::vector<std::string> fromOther;
+  size_t switches = 0;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    const std::string line = blocks[i].str();
+    (line[0] == 'b' ? fromFirst : fromOther).push_back(line);
+    if (i > 0 && line[0] != blocks[i - 1].str()[0])
+      switches++;
+  }
+  ASSERT_EQ(fromFirst, firstLines);
+  ASSERT_EQ(fromOther, otherLines);
+  ASSERT_LE(switches, (first.size() + other.size()) / (1 << 20) + 2);
+  
+  removeFile(second);
+  removeFile(third);
+  ASSERT_THROW(concat.execute(WorkerResult()), WorkerExecuteException);
+  ASSERT_THROW(merge.execute(WorkerResult()), WorkerExecuteException);
+}
+
+TEST_F(IOWorkerTest, SplitRight) {
+  workers::Split byHash(0, workers::Split::Mode::HASH, 3, TEMP_TEST_FILE, 2);
+  std::vector<std::string> text;
+  for (size_t i = 0; i < 300; i++)
+    text.push_back(std::to_string(i) + " key" + std::to_string(i % 7));
+  
+  ASSERT_EQ(byHash.execute(WorkerResult(std::vector<std::string>(text))),
+            WorkerResult());
+  std::vector<std::string> all;
+  for (size_t shard = 0; shard < 3; shard++) {
+    std::ifstream file(byHash.getShardFilename(shard));
+    std::set<std::string> keys;
+    std::string line;
+    while (std::getline(file, line)) {
+      all.push_back(line);
+      keys.insert(line.substr(line.find(' ')));
+    }
+    // Строки с равными ключами попадают в одну часть
+    for (size_t other = 0; other < shard; other++) {
+      std::ifstream previous(byHash.getShardFilename(other));
+      while (std::getline(previous, line))
+        ASSERT_EQ(keys.count(line.substr(line.find(' '))), 0);
+    }
+  }
+  std::sort(all.begin(), all.end());
+  std::sort(text.begin(), text.end());
+  ASSERT_EQ(all, text);
+  
+  workers::Split bySize(0, workers::Split::Mode::SIZE, 4, TEMP_TEST_FILE);
+  bySize.execute(WorkerResult({ "aaaa", "bbbb", "cccc", "dddd", "eeee", "ffff",
+                                "gggg", "hhhh" }));
+  ASSERT_TRUE(validateFile(TEMP_TEST_FILE + ".0", { "aaaa", "bbbb" }));
+  ASSERT_TRUE(validateFile(TEMP_TEST_FILE + ".3", { "gggg", "hhhh" }));
+  
+  for (size_t shard = 0; shard < 4; shard++)
+    removeFile(bySize.getShardFilename(shard));
+  
+  workers::Split wrong(0, workers::Split::Mode::SIZE, 2, "._temp_none_/part");
+  ASSERT_THROW(wrong.execute(WorkerResult({ "a" })), WorkerExecuteException);
+}
+
 TEST_F(IOWorkerTest, DumpRight) {
   workers::Dump dump(0, TEMP_TEST_FILE);
   
@@ -165,6 +663,28 @@ TEST_F(IOWorkerTest, DumpRight) {
             WorkerResult({ "test text" }));
 }
 
+TEST(Workers, StandardStreamRight) {
+  std::istringstream input("abc\ndef\nghi\n");
+  std::ostringstream output;
+  std::streambuf* inputBuffer = std::cin.rdbuf(input.rdbuf());
+  std::streambuf* outputBuffer = std::cout.rdbuf(output.rdbuf());
+  
+  workers::ReadFile read(0, workers::STANDARD_STREAM);
+  std::vector<std::string> lines;
+  read.scan([&](std::string& line) { lines.push_back(line); return false; });
+  const WorkerResult rest = read.execute(WorkerResult());
+  workers::WriteFile(0, workers::STANDARD_STREAM).execute(rest);
+  
+  std::cin.rdbuf(inputBuffer);
+  std::cout.rdbuf(outputBuffer);
+  
+  // Потоковое чтение не считывает строки после прерывания
+  ASSERT_EQ(lines, std::vector<std::string>({ "abc" }));
+  ASSERT_EQ(rest, WorkerResult({ "def", "ghi" }));
+  ASSERT_EQ(output.str(), "def\nghi\n");
+  ASSERT_EQ(read.getFingerprint(), "");
+}
+
 TEST_F(IOWorkerTest, ReadFileWrong) {
   workers::ReadFile read(0, TEMP_TEST_FILE);
   
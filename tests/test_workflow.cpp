@@ -0,0 +1,198 @@
+//
+//  test_workflow.cpp
+//  WorkflowTests
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "workflow.h"
+
+using namespace wkfw;
+
+static const std::string GRAPH_INPUT = "._temp_test_graph_in_";
+static const std::string GRAPH_SECOND_INPUT = "._temp_test_graph_in2_";
+static const std::string GRAPH_OUTPUT_A = "._temp_test_graph_a_";
+static const std::string GRAPH_OUTPUT_B = "._temp_test_graph_b_";
+
+/**
+ * Удаляет временные файлы по завершении теста.
+ */
+class GraphTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::ofstream(GRAPH_INPUT) << "cab\nxyz\nabc\nbar\n";
+    std::ofstream(GRAPH_SECOND_INPUT) << "aaa\nzzz\n";
+  }
+
+  void TearDown() override {
+    remove(GRAPH_INPUT.c_str());
+    remove(GRAPH_SECOND_INPUT.c_str());
+    remove(GRAPH_OUTPUT_A.c_str());
+    remove(GRAPH_OUTPUT_B.c_str());
+  }
+
+  void run(const std::string& text, const std::string& ofname = "") {
+    std::istringstream stream(text);
+    Workflow workflow(stream, GRAPH_INPUT, ofname);
+    workflow.execute();
+  }
+
+  std::vector<std::string> readLines(const std::string& filename) {
+    std::ifstream file(filename);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line))
+      lines.push_back(line);
+    return lines;
+  }
+};
+
+TEST_F(GraphTest, FanOut) {
+  run("desc 1 = grep a 2 = sort 3 = writefile " + GRAPH_OUTPUT_A +
+      " 4 = replace a A 5 = writefile " + GRAPH_OUTPUT_B +
+      " csed 1 -> 2 -> 3 1 -> 4 -> 5");
+
+  ASSERT_EQ(readLines(GRAPH_OUTPUT_A),
+            std::vector<std::string>({"abc", "bar", "cab"}));
+  ASSERT_EQ(readLines(GRAPH_OUTPUT_B),
+            std::vector<std::string>({"cAb", "Abc", "bAr"}));
+}
+
+TEST_F(GraphTest, FanIn) {
+  run("desc 1 = grep b 2 = readfile " + GRAPH_SECOND_INPUT +
+          " 3 = sort csed 1 -> 3 2 -> 3",
+      GRAPH_OUTPUT_A);
+
+  ASSERT_EQ(readLines(GRAPH_OUTPUT_A),
+            std::vector<std::string>({"aaa", "abc", "bar", "cab", "zzz"}));
+}
+
+TEST_F(GraphTest, PipeInput) {
+  // Размер канала неизвестен, он считывается до конца
+  const std::string fifo = "._temp_test_graph_fifo_";
+  const std::string text = "desc 1 = grep a 2 = replace x y 3 = sort "
+                           "4 = writefile " + GRAPH_OUTPUT_B +
+                           " csed 1 -> 2 1 -> 3 -> 4";
+  for (size_t files = 1; files <= 2; files++) {
+    remove(fifo.c_str());
+    ASSERT_EQ(mkfifo(fifo.c_str(), 0600), 0);
+    std::thread writer([&fifo]() { std::ofstream(fifo) << "cab\nxyz\nabc\n"; });
+
+    std::istringstream stream(text);
+    Workflow workflow(stream, fifo, GRAPH_OUTPUT_A);
+    if (files == 2)
+      workflow.setInputFiles({ fifo, GRAPH_SECOND_INPUT },
+                             workers::ReadFile::Mode::CONCAT);
+    EXPECT_NO_THROW(workflow.execute());
+    writer.join();
+
+    std::vector<std::string> expected = {"cab", "abc"};
+    if (files == 2)
+      expected.push_back("aaa");
+    ASSERT_EQ(readLines(GRAPH_OUTPUT_A), expected);
+  }
+  remove(fifo.c_str());
+}
+
+TEST_F(GraphTest, Wrong) {
+  // Две незаписанные ветви
+  ASSERT_THROW(run("desc 1 = grep a 2 = sort 3 = grep b csed 1 -> 2 1 -> 3",
+                   GRAPH_OUTPUT_A),
+               WorkerExecuteException);
+
+  // Ошибка в одной ветви не мешает другой
+  ASSERT_THROW(run("desc 1 = readfile ._temp_test_graph_none_ 2 = sort "
+                   "3 = writefile " + GRAPH_OUTPUT_B +
+                   " csed 1 -> 2 2 -> 3"),
+               WorkerExecuteException);
+  ASSERT_THROW(run("desc 1 = readfile ._temp_test_graph_none_ 2 = writefile " +
+                   GRAPH_OUTPUT_A + " 3 = sort 4 = writefile " +
+                   GRAPH_OUTPUT_B + " csed 1 -> 2 3 -> 4"),
+               WorkerExecuteException);
+  ASSERT_EQ(readLines(GRAPH_OUTPUT_B),
+            std::vector<std::string>({"abc", "bar", "cab", "xyz"}));
+}
+
+TEST_F(GraphTest, Limits) {
+  run("desc 1 = grep a 2 = head 2 csed 1 -> 2", GRAPH_OUTPUT_A);
+  ASSERT_EQ(readLines(GRAPH_OUTPUT_A), std::vector<std::string>({"cab", "abc"}));
+
+  run("desc 1 = replace a A 2 = grep A 3 = tail 2 csed 1 -> 2 -> 3",
+      GRAPH_OUTPUT_A);
+  ASSERT_EQ(readLines(GRAPH_OUTPUT_A), std::vector<std::string>({"Abc", "bAr"}));
+
+  run("desc 1 = sort 2 = head 3 csed 1 -> 2", GRAPH_OUTPUT_A);
+  ASSERT_EQ(readLines(GRAPH_OUTPUT_A),
+            std::vector<std::string>({"abc", "bar", "cab"}));
+
+  // Чтение остается для других потребителей
+  run("desc 1 = head 1 2 = writefile " + GRAPH_OUTPUT_B +
+          " 3 = grep x csed 1 -> 2 3",
+      GRAPH_OUTPUT_A);
+  ASSERT_EQ(readLines(GRAPH_OUTPUT_A), std::vector<std::string>({"xyz"}));
+  ASSERT_EQ(readLines(GRAPH_OUTPUT_B), std::vector<std::string>({"cab"}));
+}
+
+TEST_F(GraphTest, LimitsNonSeekable) {
+  // Канал нельзя читать с конца: tail читает его целиком
+  const std::string fifo = "._temp_test_graph_fifo_";
+  remove(fifo.c_str());
+  ASSERT_EQ(mkfifo(fifo.c_str(), 0600), 0);
+  std::thread writer([&fifo]() { std::ofstream(fifo) << "cab\nxyz\nabc\n"; });
+
+  std::istringstream stream("desc 1 = grep a 2 = tail 1 csed 1 -> 2");
+  EXPECT_NO_THROW(Workflow(stream, fifo, GRAPH_OUTPUT_A).execute());
+  writer.join();
+  remove(fifo.c_str());
+  ASSERT_EQ(readLines(GRAPH_OUTPUT_A), std::vector<std::string>({"abc"}));
+
+  // Строки длиннее блока чтения с конца
+  const std::string longLine(300000, 'a');
+  std::ofstream(GRAPH_INPUT) << "x\n" << longLine << "\nb" << longLine
+                             << "\n\nc\n";
+  run("desc 1 = tail 4 csed 1", GRAPH_OUTPUT_A);
+  ASSERT_EQ(readLines(GRAPH_OUTPUT_A),
+            std::vector<std::string>({longLine, "b" + longLine, "", "c"}));
+}
+
+TEST_F(GraphTest, LimitsRewrite) {
+  std::istringstream stream(
+      "desc 1 = grep a 2 = tail 1 3 = sort 4 = head 5 csed 1 -> 2 -> 3 -> 4");
+  Workflow workflow(stream, GRAPH_INPUT, GRAPH_OUTPUT_A);
+  const ExecutionGraph& graph = workflow.getGraph();
+
+  // Чтение, grep и tail слиты, sort и head заменены на top
+  ASSERT_EQ(graph.size(), 3);
+  ASSERT_NE(dynamic_cast<const workers::LimitedRead*>(graph.getWorker(0)),
+            nullptr);
+  ASSERT_NE(dynamic_cast<const workers::Top*>(graph.getWorker(1)), nullptr);
+  ASSERT_EQ(graph.getWorker(1)->getId(), 4);
+
+  // Граф составлен при создании, исполнения его не пересоставляют
+  const Worker* reader = graph.getWorker(0);
+  workflow.execute();
+  workflow.execute();
+  ASSERT_EQ(&workflow.getGraph(), &graph);
+  ASSERT_EQ(workflow.getGraph().getWorker(0), reader);
+  ASSERT_EQ(readLines(GRAPH_OUTPUT_A), std::vector<std::string>({"bar"}));
+}
+
+TEST(Workers, SharedResult) {
+  WorkerResult result({"abc", "def"});
+  WorkerResult copy = result;
+
+  ASSERT_EQ(&result.getValue(), &copy.getValue());
+  ASSERT_EQ(result, copy);
+  ASSERT_NE(result, WorkerResult());
+  ASSERT_THROW(WorkerResult().getValue(), NoResultException);
+}
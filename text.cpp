@@ -0,0 +1,231 @@
+//
+//  text.cpp
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <algorithm>
+#include <limits>
+
+#include "text.h"
+
+namespace wkfw {
+
+// Начальный размер собственного столбца строителя
+static const uint64_t INITIAL_CAPACITY = 4 << 10;
+
+// Выборка из столбца другой арены сжимается, если выбрано не больше
+// этой доли его байт
+static const uint64_t SPARSE_RATIO = 8;
+
+const char* findBytes(const char* data,
+                      const size_t size,
+                      const std::string& pattern) {
+  if (pattern.empty())
+    return data;
+
+  const char* end = data + size;
+  while ((size_t)(end - data) >= pattern.size()) {
+    const char* found = (const char*)memchr(
+        data, pattern[0], end - data - pattern.size() + 1);
+    if (found == nullptr)
+      return nullptr;
+    if (memcmp(found + 1, pattern.data() + 1, pattern.size() - 1) == 0)
+      return found;
+    data = found + 1;
+  }
+  return nullptr;
+}
+
+size_t Line::find(const std::string& pattern, const size_t from) const {
+  if (from > size)
+    return std::string::npos;
+  const char* found = findBytes(data + from, size - from, pattern);
+  return found == nullptr ? std::string::npos : found - data;
+}
+
+std::ostream& operator<<(std::ostream& output, const Line& line) {
+  return output.write(line.data, line.size);
+}
+
+bool Text::operator==(const Text& other) const {
+  if (size() != other.size())
+    return false;
+  for (size_t i = 0; i < size(); i++)
+    if ((*this)[i] != other[i])
+      return false;
+  return true;
+}
+
+std::vector<std::string> Text::toStrings() const {
+  std::vector<std::string> strings;
+  strings.reserve(size());
+  for (auto const& line : *this)
+    strings.push_back(line.str());
+  return strings;
+}
+
+TextBuilder::TextBuilder(std::shared_ptr<Arena> arena)
+    : arena(arena ? arena : std::make_shared<Arena>()),
+      bytes(nullptr),
+      capacity(0),
+      offsets(1, 0),
+      terminated(true),
+      whole(true),
+      ordered(true),
+      expected(0) {}
+
+void TextBuilder::reserve(const size_t lines) {
+  // Пока неизвестно, будет ли текст выборкой или столбцом
+  expected = lines;
+  if (source)
+    selection.reserve(lines);
+  else if (offsets.size() > 1)
+    offsets.reserve(lines + 1);
+}
+
+void TextBuilder::grow(const uint64_t size) {
+  const uint64_t length = offsets.back();
+  if (length + size <= capacity)
+    return;
+
+  // Удвоение: большие столбцы занимают отдельные куски арены
+  // и переотображаются без копирования
+  const uint64_t wanted =
+      std::max(std::max(capacity * 2, length + size), INITIAL_CAPACITY);
+  bytes = bytes == nullptr ? arena->allocate(wanted)
+                           : arena->resize(bytes, capacity, wanted);
+  capacity = wanted;
+}
+
+void TextBuilder::materialize() {
+  if (!source)
+    return;
+
+  const std::shared_ptr<const TextColumn> column = std::move(source);
+  std::vector<uint32_t> lines;
+  lines.swap(selection);
+  source.reset();
+  whole = true;
+  ordered = true;
+
+  uint64_t size = 0;
+  for (auto line : lines)
+    size += (*column)[line].size + 1;
+  grow(size);
+  offsets.reserve(std::max(expected, lines.size()) + 1);
+  for (auto line : lines)
+    copy((*column)[line]);
+}
+
+void TextBuilder::copy(const Line& line) {
+  char* target = addLine(line.size);
+  if (line.size > 0)
+    memcpy(target, line.data, line.size);
+}
+
+char* TextBuilder::addLine(const size_t size) {
+  materialize();
+  grow(size + 1);
+  const uint64_t length = offsets.back();
+  if (length > 0 && bytes[length - 1] != '\n')
+    terminated = false;
+  if (offsets.size() == 1)
+    offsets.reserve(expected + 1);
+
+  char* line = bytes + length;
+  line[size] = '\n';
+  offsets.push_back(length + size + 1);
+  return line;
+}
+
+char* TextBuilder::reserveBytes(const size_t size) {
+  materialize();
+  grow(size);
+  return bytes + offsets.back();
+}
+
+void TextBuilder::addLines(const size_t size) {
+  const uint64_t length = offsets.back();
+  if (size == 0)
+    return;
+  if (length > 0 && bytes[length - 1] != '\n')
+    terminated = false;
+
+  const char* end = bytes + length + size;
+  for (const char* line = bytes + length; line < end;) {
+    const char* found = (const char*)memchr(line, '\n', end - line);
+    line = found != nullptr ? found + 1 : end;
+    offsets.push_back(line - bytes);
+  }
+}
+
+void TextBuilder::keep(const Text& text, const size_t line) {
+  const size_t position = text.getPosition(line);
+  if (position <= std::numeric_limits<uint32_t>::max() &&
+      (source.get() == text.getColumn() ||
+       (!source && offsets.size() == 1))) {
+    if (!source) {
+      source = text.column;
+      selection.reserve(expected);
+    }
+    whole = whole && position == selection.size();
+    ordered = ordered && (selection.empty() || position > selection.back());
+    selection.push_back(position);
+    return;
+  }
+
+  copy(text[line]);
+}
+
+void TextBuilder::append(const Text& text) {
+  for (size_t i = 0; i < text.size(); i++)
+    keep(text, i);
+}
+
+bool TextBuilder::isSparse() const {
+  if (source->arena == arena)
+    return false;
+
+  uint64_t size = 0;
+  for (auto line : selection)
+    size += source->getOffset(line + 1) - source->getOffset(line);
+  return size * SPARSE_RATIO <= source->getLength();
+}
+
+Text TextBuilder::build() {
+  if (source && isSparse())
+    materialize();
+
+  Text result;
+  if (source) {
+    result.column = source;
+    result.ordered = ordered;
+    // Выборка всех строк столбца подряд не нужна
+    if (!whole || selection.size() != source->size())
+      result.selection =
+          std::make_shared<const std::vector<uint32_t>>(std::move(selection));
+  } else if (offsets.size() > 1) {
+    auto column = std::make_shared<TextColumn>();
+    column->bytes = bytes;
+    column->offsets = std::move(offsets);
+    column->terminated = terminated;
+    column->arena = arena;
+    result.column = column;
+  }
+
+  bytes = nullptr;
+  capacity = 0;
+  offsets = std::vector<uint64_t>(1, 0);
+  terminated = true;
+  source.reset();
+  selection = std::vector<uint32_t>();
+  whole = true;
+  ordered = true;
+  expected = 0;
+  return result;
+}
+
+}  // namespace wkfw
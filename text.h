@@ -0,0 +1,350 @@
+//
+//  text.h
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef TEXT_H_
+#define TEXT_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+
+namespace wkfw {
+
+/**
+ * Ищет pattern в size байтах data. Кандидаты - вхождения первого байта
+ * образца (memchr просматривает байты векторно), остаток образца
+ * сравнивается на месте. На обычном тексте это быстрее memmem,
+ * который разбирает образец при каждом вызове.
+ *
+ * @return Начало первого вхождения или nullptr.
+ */
+const char* findBytes(const char* data,
+                      const size_t size,
+                      const std::string& pattern);
+
+/**
+ * Строка текста: ссылка на байты, которыми владеет текст.
+ * Действительна, пока жив текст, которому она принадлежит.
+ */
+struct Line {
+  const char* data;
+  size_t size;
+
+  Line() : data(""), size(0) {}
+  Line(const char* data, const size_t size) : data(data), size(size) {}
+  explicit Line(const std::string& line)
+      : data(line.data()), size(line.size()) {}
+
+  std::string str() const { return std::string(data, size); }
+
+  /**
+   * @return Позиция первого вхождения pattern не раньше from
+   * или std::string::npos.
+   */
+  size_t find(const std::string& pattern, const size_t from = 0) const;
+
+  int compare(const Line& other) const {
+    int result = memcmp(data, other.data, std::min(size, other.size));
+    return result != 0 ? result : (size < other.size ? -1 : size > other.size);
+  }
+
+  bool operator==(const Line& other) const {
+    return size == other.size && memcmp(data, other.data, size) == 0;
+  }
+
+  bool operator!=(const Line& other) const { return !(*this == other); }
+
+  bool operator<(const Line& other) const { return compare(other) < 0; }
+};
+
+std::ostream& operator<<(std::ostream& output, const Line& line);
+
+/**
+ * Столбец строк: байты всех строк подряд в одном участке арены и смещения
+ * начал строк. Строка i занимает байты [offsets[i], offsets[i + 1]) без
+ * завершающего переноса строки, поэтому столбцом может быть содержимое
+ * файла как есть.
+ */
+class TextColumn {
+ public:
+  size_t size() const { return offsets.size() - 1; }
+
+  Line operator[](const size_t line) const {
+    const char* begin = bytes + offsets[line];
+    size_t size = offsets[line + 1] - offsets[line];
+    if (size > 0 && begin[size - 1] == '\n')
+      size--;
+    return Line(begin, size);
+  }
+
+  /**
+   * @return Байты строк подряд.
+   */
+  const char* getBytes() const { return bytes; }
+
+  uint64_t getLength() const { return offsets.back(); }
+
+  /**
+   * @return Смещение начала строки line, для line == size() - длина байт.
+   */
+  uint64_t getOffset(const size_t line) const { return offsets[line]; }
+
+  /**
+   * @return Номер строки, которой принадлежит байт position, если он
+   * не раньше начала строки from. Поиск идет от from с удвоением шага,
+   * поэтому близкие строки находятся быстро.
+   */
+  size_t findLine(const uint64_t position, const size_t from = 0) const {
+    size_t begin = from + 1;
+    size_t step = 1;
+    while (begin + step < offsets.size() && offsets[begin + step] <= position) {
+      begin += step;
+      step *= 2;
+    }
+    const size_t end = std::min(begin + step + 1, offsets.size());
+    return std::upper_bound(offsets.begin() + begin, offsets.begin() + end,
+                            position) -
+           offsets.begin() - 1;
+  }
+
+  /**
+   * @return true, если все строки, кроме, может быть, последней, завершены
+   * переносом: байты столбца - готовый текст для записи в файл.
+   */
+  bool isTerminated() const { return terminated; }
+
+ private:
+  friend class TextBuilder;
+
+  const char* bytes;
+  std::vector<uint64_t> offsets;
+  bool terminated;
+  std::shared_ptr<const Arena> arena;
+};
+
+/**
+ * Неизменяемый текст: столбец строк и, возможно, выборка - номера строк
+ * столбца, составляющих текст. Фильтры и сортировка строят выборку,
+ * не копируя строки, и разделяют столбец с исходным текстом.
+ */
+class Text {
+ public:
+  /**
+   * Итератор по строкам текста, строки возвращаются по значению.
+   */
+  class const_iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Line value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Line* pointer;
+    typedef Line reference;
+
+    const_iterator(const Text* text, const size_t line)
+        : text(text), line(line) {}
+
+    Line operator*() const { return (*text)[line]; }
+
+    const_iterator& operator++() {
+      line++;
+      return *this;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return line == other.line;
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return line != other.line;
+    }
+
+   private:
+    const Text* text;
+    size_t line;
+  };
+
+  size_t size() const {
+    return selection ? selection->size() : (column ? column->size() : 0);
+  }
+
+  bool empty() const { return size() == 0; }
+
+  Line operator[](const size_t line) const {
+    return (*column)[getPosition(line)];
+  }
+
+  Line front() const { return (*this)[0]; }
+  Line back() const { return (*this)[size() - 1]; }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+
+  /**
+   * @return Номер строки line в столбце текста.
+   */
+  size_t getPosition(const size_t line) const {
+    return selection ? (*selection)[line] : line;
+  }
+
+  /**
+   * @return Столбец строк или nullptr, если текст пуст.
+   */
+  const TextColumn* getColumn() const { return column.get(); }
+
+  /**
+   * @return true, если текст - выборка из столбца, а не все его строки.
+   */
+  bool isSelection() const { return selection != nullptr; }
+
+  /**
+   * @return true, если строки текста идут в порядке столбца, как после
+   * фильтров. Тогда текст можно просматривать по байтам столбца подряд.
+   */
+  bool isOrdered() const { return ordered; }
+
+  bool operator==(const Text& other) const;
+  bool operator!=(const Text& other) const { return !(*this == other); }
+
+  /**
+   * @return Копии строк текста.
+   */
+  std::vector<std::string> toStrings() const;
+
+ private:
+  friend class TextBuilder;
+
+  std::shared_ptr<const TextColumn> column;
+  std::shared_ptr<const std::vector<uint32_t>> selection;
+  bool ordered = true;
+};
+
+/**
+ * Построение текста. Пока добавляются только строки одного столбца (keep),
+ * строитель собирает выборку из него. Новые строки копируются в собственный
+ * столбец строителя; если в нем уже есть строки из выборки или из другого
+ * столбца, они тоже копируются.
+ *
+ * Выборка удерживает весь столбец источника. Если он размещен в другой
+ * арене, а выбрана малая часть его байт, выборка при построении сжимается:
+ * строки копируются, и арена источника освобождается вместе с ним.
+ *
+ * Строитель используется одним потоком, арена может быть общей.
+ */
+class TextBuilder {
+ public:
+  /**
+   * @param arena Арена для байт столбца или nullptr, чтобы создать свою.
+   */
+  explicit TextBuilder(std::shared_ptr<Arena> arena = nullptr);
+
+  void reserve(const size_t lines);
+
+  /**
+   * @return Количество добавленных строк.
+   */
+  size_t size() const {
+    return source ? selection.size() : offsets.size() - 1;
+  }
+
+  /**
+   * Копирует строку в столбец.
+   */
+  void add(const char* data, const size_t size) {
+    char* line = addLine(size);
+    if (size > 0)
+      memcpy(line, data, size);
+  }
+
+  void add(const std::string& line) { add(line.data(), line.size()); }
+
+  /**
+   * Добавляет строку из size байт, которые заполняет вызывающий.
+   *
+   * @return Байты строки, действительны до следующего изменения строителя.
+   */
+  char* addLine(const size_t size);
+
+  /**
+   * Выделяет в конце столбца size байт, например под содержимое файла.
+   * Строками их делает addLines.
+   *
+   * @return Байты, действительны до следующего изменения строителя.
+   */
+  char* reserveBytes(const size_t size);
+
+  /**
+   * Добавляет строки из первых size байт, выделенных reserveBytes.
+   * Байты делятся по переносам строки, перенос в конце не начинает
+   * новую строку. Остальные выделенные байты остаются в начале
+   * следующего выделения.
+   */
+  void addLines(const size_t size);
+
+  /**
+   * Добавляет строку другого текста, по возможности без копирования.
+   */
+  void keep(const Text& source, const size_t line);
+
+  /**
+   * Добавляет все строки другого текста, по возможности без копирования.
+   */
+  void append(const Text& source);
+
+  /**
+   * @return Построенный текст. Строитель после этого пуст.
+   */
+  Text build();
+
+ private:
+  std::shared_ptr<Arena> arena;
+
+  // Собственный столбец: байты строк и смещения их начал
+  char* bytes;
+  uint64_t capacity;
+  std::vector<uint64_t> offsets;
+  bool terminated;
+
+  // Выборка из чужого столбца, признак того, что она - его строки
+  // с первой подряд, и признак возрастания номеров
+  std::shared_ptr<const TextColumn> source;
+  std::vector<uint32_t> selection;
+  bool whole;
+  bool ordered;
+
+  // Ожидаемое количество строк (reserve)
+  size_t expected;
+
+  /**
+   * Гарантирует место под size байт в конце собственного столбца.
+   */
+  void grow(const uint64_t size);
+
+  /**
+   * Копирует строки выборки в собственный столбец.
+   */
+  void materialize();
+
+  /**
+   * @return true, если выборку выгоднее сжать (см. описание класса).
+   */
+  bool isSparse() const;
+
+  void copy(const Line& line);
+};
+
+}  // namespace wkfw
+
+#endif /* TEXT_H_ */
@@ -0,0 +1,62 @@
+//
+//  thread_pool.cpp
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "thread_pool.h"
+
+namespace wkfw {
+
+ThreadPool::ThreadPool(size_t count) {
+  if (count == 0)
+    count = std::thread::hardware_concurrency();
+  if (count == 0)
+    count = 1;
+
+  for (size_t i = 0; i < count; i++)
+    threads.push_back(std::thread(&ThreadPool::work, this));
+}
+
+void ThreadPool::submit(const std::function<void()>& task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push(task);
+  }
+  condition.notify_one();
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  condition.notify_all();
+
+  for (auto& thread : threads)
+    thread.join();
+}
+
+void ThreadPool::work() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+      if (tasks.empty())
+        return;
+      task = std::move(tasks.front());
+      tasks.pop();
+    }
+
+    // Исключение задачи не должно завершать поток пула и весь процесс
+    try {
+      task();
+    } catch (...) {
+    }
+  }
+}
+
+}  // namespace wkfw
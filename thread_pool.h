@@ -0,0 +1,61 @@
+//
+//  thread_pool.h
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace wkfw {
+
+/**
+ * Пул потоков фиксированного размера с общей очередью задач.
+ */
+class ThreadPool {
+ public:
+  /**
+   * @param threads Количество потоков. Если 0 - по числу ядер.
+   */
+  ThreadPool(size_t threads = 0);
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * Ставит задачу в очередь на исполнение.
+   */
+  void submit(const std::function<void()>& task);
+
+  /**
+   * @return Количество потоков пула.
+   */
+  size_t size() const { return threads.size(); }
+
+  /**
+   * Дожидается выполнения всех поставленных задач и останавливает потоки.
+   */
+  ~ThreadPool();
+
+ private:
+  std::vector<std::thread> threads;
+  std::queue<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping = false;
+
+  void work();
+};
+
+}  // namespace wkfw
+
+#endif /* THREAD_POOL_H_ */
@@ -0,0 +1,58 @@
+//
+//  worker.cpp
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "worker.h"
+
+namespace wkfw {
+
+/**
+ * Исполнение блока целиком при первом запросе (см. Worker::open).
+ */
+class WholeCursor : public Cursor {
+ public:
+  WholeCursor(const Worker* worker,
+              std::unique_ptr<Cursor> input,
+              std::shared_ptr<MemoryBudget> budget)
+      : worker(worker), input(std::move(input)), budget(budget), done(false) {}
+
+  bool next(Text& batch) throw(WorkerExecuteException) override {
+    if (done)
+      return false;
+    done = true;
+
+    auto arena = std::make_shared<Arena>(budget);
+    WorkerResult previous;
+    if (input) {
+      TextBuilder whole(arena);
+      Text part;
+      while (input->next(part))
+        whole.append(part);
+      previous = WorkerResult(whole.build());
+    }
+
+    const WorkerResult result = worker->execute(previous.withArena(arena));
+    if (result.getType() == WorkerResult::NONE)
+      return false;
+    batch = result.getValue();
+    return true;
+  }
+
+ private:
+  const Worker* worker;
+  std::unique_ptr<Cursor> input;
+  std::shared_ptr<MemoryBudget> budget;
+  bool done;
+};
+
+std::unique_ptr<Cursor> Worker::open(std::unique_ptr<Cursor> input,
+                                     std::shared_ptr<MemoryBudget> budget) const
+    throw(WorkerExecuteException) {
+  return std::unique_ptr<Cursor>(new WholeCursor(this, std::move(input), budget));
+}
+
+}  // namespace wkfw
@@ -10,9 +10,15 @@
 #define WORKER_H_
 
 #include <exception>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "arena.h"
+#include "fields.h"
+#include "text.h"
+
 namespace wkfw {
 
 /**
@@ -37,8 +43,24 @@ class WorkerExecuteException : public std::exception {
   const std::string description;
 };
 
+/**
+ * Бросается, если выделение памяти превысило бы ограничение
+ * (см. MemoryBudget).
+ */
+class MemoryLimitException : public WorkerExecuteException {
+ public:
+  MemoryLimitException() : WorkerExecuteException("Memory limit exceeded.") {}
+};
+
 /**
  * Результат выполнения Worker-а.
+ *
+ * Текст хранится в разделяемом неизменяемом буфере, поэтому копирование
+ * результата (например, передача одного результата нескольким блокам)
+ * не копирует строки.
+ *
+ * Результат, переданный обработчику, несет арену исполнения, в которой
+ * обработчик размещает новые строки (см. TextBuilder).
  */
 class WorkerResult {
  public:
@@ -50,28 +72,52 @@ class WorkerResult {
   WorkerResult() : type(NONE) {}
 
   /**
-   * Результат выполнения - текст.
+   * Результат выполнения - текст, строки копируются в новую арену.
+   *
+   * @param value Результат выполнения.
+   */
+  WorkerResult(const std::vector<std::string>& value) : type(TEXT) {
+    TextBuilder builder;
+    builder.reserve(value.size());
+    for (auto const& line : value)
+      builder.add(line);
+    this->value = std::make_shared<const Text>(builder.build());
+    fields = std::make_shared<LazyFields>();
+  }
+
+  /**
+   * Результат выполнения - текст, без копирования строк.
    *
    * @param value Результат выполнения.
    */
-  WorkerResult(const std::vector<std::string>& value)
-      : type(TEXT), value(value) {}
+  WorkerResult(Text&& value)
+      : type(TEXT),
+        value(std::make_shared<const Text>(std::move(value))),
+        fields(std::make_shared<LazyFields>()) {}
 
   WorkerResult(const WorkerResult& result)
-      : type(result.type), value(result.value) {}
+      : type(result.type),
+        value(result.value),
+        fields(result.fields),
+        arena(result.arena) {}
 
   WorkerResult& operator=(const WorkerResult& from) {
     type = from.type;
     value = from.value;
+    fields = from.fields;
+    arena = from.arena;
     return (*this);
   }
 
   bool operator==(const WorkerResult& other) const {
-    return type == other.type && value == other.value;
+    return type == other.type &&
+           (value == other.value ||
+            (value != nullptr && other.value != nullptr &&
+             *value == *other.value));
   }
 
   bool operator!=(const WorkerResult& other) const {
-    return type != other.type || value != other.value;
+    return !(*this == other);
   }
 
   /**
@@ -82,15 +128,74 @@ class WorkerResult {
   /**
    * @return Результат выполнения.
    */
-  const std::vector<std::string> getValue() const throw(NoResultException) {
+  const Text& getValue() const throw(NoResultException) {
     if (type == NONE)
       throw NoResultException();
-    return value;
+    return *value;
+  }
+
+  /**
+   * Индекс полей строк результата. Строится при первом обращении
+   * и разделяется всеми копиями результата.
+   */
+  const FieldIndex& getFields() const throw(NoResultException) {
+    if (type == NONE)
+      throw NoResultException();
+    std::call_once(fields->once,
+                   [this] { fields->index.reset(new FieldIndex(*value)); });
+    return *fields->index;
+  }
+
+  /**
+   * @return Арена исполнения или nullptr.
+   */
+  std::shared_ptr<Arena> getArena() const { return arena; }
+
+  /**
+   * @return Учет памяти исполнения или nullptr.
+   */
+  std::shared_ptr<MemoryBudget> getBudget() const {
+    return arena ? arena->getBudget() : nullptr;
+  }
+
+  /**
+   * @return Копия результата, несущая арену исполнения.
+   */
+  WorkerResult withArena(std::shared_ptr<Arena> arena) const {
+    WorkerResult result(*this);
+    result.arena = arena;
+    return result;
   }
 
  private:
+  struct LazyFields {
+    std::once_flag once;
+    std::unique_ptr<const FieldIndex> index;
+  };
+
   ResultType type;
-  std::vector<std::string> value;
+  std::shared_ptr<const Text> value;
+  std::shared_ptr<LazyFields> fields;
+  std::shared_ptr<Arena> arena;
+};
+
+/**
+ * Ленивый результат блока: текст вычисляется частями по запросу
+ * потребителя (см. Worker::open). Потребитель, которому строки больше
+ * не нужны, перестает запрашивать части, и предшествующие блоки
+ * не вычисляют остаток текста.
+ */
+class Cursor {
+ public:
+  /**
+   * Вычисляет следующую часть результата.
+   *
+   * @param batch Часть результата, может быть пустой.
+   * @return false, если результат исчерпан.
+   */
+  virtual bool next(Text& batch) throw(WorkerExecuteException) = 0;
+
+  virtual ~Cursor() {}
 };
 
 /**
@@ -114,11 +219,33 @@ class Worker {
   virtual const WorkerResult execute(const WorkerResult& previous) const
       throw(WorkerExecuteException) = 0;
 
+  /**
+   * Открывает ленивое исполнение блока. По умолчанию при первом запросе
+   * все части входа собираются в один текст и блок исполняется целиком
+   * (execute), результат выдается одной частью.
+   *
+   * @param input Ленивый вход или nullptr, если блок не принимает текст.
+   * @param budget Учет памяти исполнения или nullptr.
+   */
+  virtual std::unique_ptr<Cursor> open(std::unique_ptr<Cursor> input,
+                                       std::shared_ptr<MemoryBudget> budget)
+      const throw(WorkerExecuteException);
+
   /**
    * @return Уникальный номер инструкции в общем наборе инструкций
    * */
   size_t getId() const { return identifier; }
 
+  /**
+   * Отпечаток обработчика: его тип и параметры.
+   * Одинаковые отпечатки означают одинаковый результат на одинаковых входных
+   * данных, поэтому результат можно взять из кэша.
+   *
+   * @return Отпечаток или пустая строка, если результат не может
+   * кэшироваться (обработчик имеет побочные эффекты).
+   */
+  virtual std::string getFingerprint() const { return ""; }
+
   WorkerResult::ResultType getReturnType() const { return returnType; }
 
   WorkerResult::ResultType getAcceptType() const { return acceptType; }
@@ -6,140 +6,2587 @@
 //  Copyright © 2017 Кирилл. All rights reserved.
 //
 
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
 #include <vector>
 
+#include "hash.h"
 #include "workers.h"
 
 namespace workers {
 
+/**
+ * Разбирает неотрицательное целое число.
+ *
+ * @return true, если строка - число.
+ */
+static bool parseNumber(const std::string& str, size_t& number) {
+  if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos)
+    return false;
+  try {
+    number = std::stoull(str);
+  } catch (const std::out_of_range& e) {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Разбирает список полей вида "1,3,5-7".
+ *
+ * @return true, если список корректен.
+ */
+static bool parseFields(const std::string& str, std::vector<size_t>& fields) {
+  size_t begin = 0;
+  while (begin <= str.size()) {
+    size_t end = str.find(',', begin);
+    if (end == std::string::npos)
+      end = str.size();
+    const std::string item = str.substr(begin, end - begin);
+    const size_t dash = item.find('-');
+
+    size_t first, last;
+    if (dash == std::string::npos) {
+      if (!parseNumber(item, first))
+        return false;
+      last = first;
+    } else if (!parseNumber(item.substr(0, dash), first) ||
+               !parseNumber(item.substr(dash + 1), last) || last < first) {
+      return false;
+    }
+    if (first == 0)
+      return false;
+    for (size_t field = first; field <= last; field++)
+      fields.push_back(field);
+
+    begin = end + 1;
+  }
+  return true;
+}
+
+/**
+ * Разбирает параметры сортировки: by <поле>, numeric, human, version,
+ * unique, count.
+ *
+ * @return true, если параметры корректны.
+ */
+static bool parseSortOptions(const std::vector<std::string>& args,
+                             Sort::Collapse& collapse,
+                             size_t& field,
+                             Sort::Order& order) {
+  for (size_t i = 0; i < args.size(); i++) {
+    if (args[i] == "numeric" && order == Sort::Order::TEXT)
+      order = Sort::Order::NUMERIC;
+    else if (args[i] == "human" && order == Sort::Order::TEXT)
+      order = Sort::Order::HUMAN;
+    else if (args[i] == "version" && order == Sort::Order::TEXT)
+      order = Sort::Order::VERSION;
+    else if (args[i] == "unique" && collapse == Sort::Collapse::NONE)
+      collapse = Sort::Collapse::UNIQUE;
+    else if (args[i] == "count" && collapse == Sort::Collapse::NONE)
+      collapse = Sort::Collapse::COUNT;
+    else if (args[i] == "by" && field == 0 && i + 1 < args.size() &&
+             parseNumber(args[i + 1], field) && field > 0)
+      i++;
+    else
+      return false;
+  }
+  return true;
+}
+
+/**
+ * Наименьшее количество потоков чтения нескольких файлов: чтение упирается
+ * в ввод-вывод, а не в процессор.
+ */
+static const size_t READ_THREADS = 4;
+
+/**
+ * Минимальное количество строк в одной части текста при параллельной обработке.
+ */
+static const size_t MIN_PARTITION_LINES = 1 << 16;
+
+/**
+ * @return На сколько частей стоит разбить текст из lines строк.
+ */
+static size_t countPartitions(const size_t lines) {
+  size_t parts = std::min<size_t>(std::thread::hardware_concurrency(),
+                                  lines / MIN_PARTITION_LINES);
+  return std::max<size_t>(parts, 1);
+}
+
+/**
+ * Обрабатывает диапазон строк [0, lines), разбитый на parts частей,
+ * каждую в своем потоке. Исключение одной из частей (например,
+ * превышение ограничения памяти) передается вызывающему после
+ * завершения всех частей.
+ *
+ * @param body Обработчик части: номер части, начало и конец диапазона.
+ */
+static void forEachPartition(
+    const size_t lines,
+    const size_t parts,
+    const std::function<void(size_t, size_t, size_t)>& body) {
+  std::vector<std::exception_ptr> errors(parts);
+  auto run = [&](const size_t part) {
+    try {
+      body(part, lines * part / parts, lines * (part + 1) / parts);
+    } catch (...) {
+      errors[part] = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t part = 1; part < parts; part++)
+    threads.push_back(std::thread(run, part));
+  run(0);
+  for (auto& thread : threads)
+    thread.join();
+
+  for (auto const& error : errors)
+    if (error)
+      std::rethrow_exception(error);
+}
+
 const wkfw::Worker* constructWorker(const size_t ident,
                                     const std::string& name,
                                     const std::vector<std::string>& args) {
   if (name == "readfile") {
-    if (args.size() == 1)
-      return new ReadFile(ident, args[0]);
+    ReadFile::Mode mode = ReadFile::Mode::CONCAT;
+    std::vector<std::string> patterns;
+    for (auto const& arg : args) {
+      if (arg == "--merge" && mode == ReadFile::Mode::CONCAT)
+        mode = ReadFile::Mode::MERGE;
+      else if (arg == "--interleave" && mode == ReadFile::Mode::CONCAT)
+        mode = ReadFile::Mode::INTERLEAVE;
+      else
+        patterns.push_back(arg);
+    }
+    if (!patterns.empty())
+      return new ReadFile(ident, patterns, mode);
   } else if (name == "writefile") {
     if (args.size() == 1)
       return new WriteFile(ident, args[0]);
+  } else if (name == "split") {
+    size_t shards;
+    size_t field = 0;
+    if ((args.size() == 3 || args.size() == 4) &&
+        parseNumber(args[1], shards) && shards > 0 &&
+        (args.size() == 3 || (parseNumber(args[3], field) && field > 0))) {
+      if (args[0] == "hash")
+        return new Split(ident, Split::Mode::HASH, shards, args[2], field);
+      if (args[0] == "size" && args.size() == 3)
+        return new Split(ident, Split::Mode::SIZE, shards, args[2]);
+    }
   } else if (name == "grep") {
     if (args.size() == 1)
       return new Grep(ident, args[0]);
   } else if (name == "sort") {
-    if (args.size() == 0)
-      return new Sort(ident);
+    Sort::Collapse collapse = Sort::Collapse::NONE;
+    Sort::Order order = Sort::Order::TEXT;
+    size_t field = 0;
+    if (parseSortOptions(args, collapse, field, order))
+      return new Sort(ident, collapse, field, order);
+  } else if (name == "cut") {
+    std::vector<size_t> fields;
+    if (args.size() == 1 && parseFields(args[0], fields))
+      return new Cut(ident, fields);
+  } else if (name == "fieldgrep") {
+    size_t field;
+    if (args.size() == 2 && parseNumber(args[0], field) && field > 0)
+      return new FieldGrep(ident, field, args[1]);
+  } else if (name == "top") {
+    size_t count;
+    if (args.size() == 1 && parseNumber(args[0], count))
+      return new Top(ident, count);
+  } else if (name == "head") {
+    size_t count;
+    if (args.size() == 1 && parseNumber(args[0], count))
+      return new Head(ident, count);
+  } else if (name == "tail") {
+    size_t count;
+    if (args.size() == 1 && parseNumber(args[0], count))
+      return new Tail(ident, count);
+  } else if (name == "aggregate") {
+    size_t keyField, valueField = 0;
+    if ((args.size() != 2 && args.size() != 3) ||
+        !parseNumber(args[0], keyField) || keyField == 0 ||
+        (args.size() == 3 && (!parseNumber(args[2], valueField) || valueField == 0)))
+      return nullptr;
+    if (args[1] == "count" && args.size() == 2)
+      return new Aggregate(ident, keyField, Aggregate::Operation::COUNT, 0);
+    if (args[1] == "sum" && args.size() == 3)
+      return new Aggregate(ident, keyField, Aggregate::Operation::SUM,
+                           valueField);
+    if (args[1] == "min" && args.size() == 3)
+      return new Aggregate(ident, keyField, Aggregate::Operation::MIN,
+                           valueField);
+    if (args[1] == "max" && args.size() == 3)
+      return new Aggregate(ident, keyField, Aggregate::Operation::MAX,
+                           valueField);
+  } else if (name == "join") {
+    size_t field;
+    if (args.size() == 2 && parseNumber(args[1], field) && field > 0)
+      return new Join(ident, args[0], field);
   } else if (name == "replace") {
     if (args.size() == 2)
       return new Replace(ident, args[0], args[1]);
   } else if (name == "dump") {
     if (args.size() == 1)
       return new Dump(ident, args[0]);
+  } else if (name == "uniq") {
+    if (args.size() == 0)
+      return new Uniq(ident);
+  } else if (name == "approxuniq") {
+    size_t expected = 0;
+    if (args.size() == 0 || (args.size() == 1 && parseNumber(args[0], expected)))
+      return new ApproxUniq(ident, expected);
   }
 
   return nullptr;
 }
 
+const wkfw::WorkerResult LineWorker::execute(
+    const wkfw::WorkerResult& previous) const
+    throw(wkfw::WorkerExecuteException) {
+  const size_t lines = previous.getValue().size();
+  wkfw::TextBuilder list(previous.getArena());
+  list.reserve(lines);
+
+  for (size_t begin = 0; begin < lines; begin += BATCH_LINES)
+    processBatch(previous, begin, std::min(begin + BATCH_LINES, lines), list);
+
+  return wkfw::WorkerResult(list.build());
+}
+
+wkfw::Text applyLineWorkers(const std::vector<const LineWorker*>& stages,
+                            const wkfw::Text& text,
+                            std::shared_ptr<wkfw::Arena> arena) throw(
+    wkfw::WorkerExecuteException) {
+  wkfw::Text copy(text);
+  wkfw::WorkerResult result(std::move(copy));
+  for (auto stage : stages)
+    result = stage->execute(result.withArena(arena));
+  return result.getValue();
+}
+
+/**
+ * Ленивое исполнение построчного обработчика (см. LineWorker::open).
+ */
+class LineCursor : public wkfw::Cursor {
+ public:
+  LineCursor(const LineWorker* worker,
+             std::unique_ptr<wkfw::Cursor> input,
+             std::shared_ptr<wkfw::MemoryBudget> budget)
+      : worker(worker), input(std::move(input)), budget(budget) {}
+
+  bool next(wkfw::Text& batch) throw(wkfw::WorkerExecuteException) override {
+    wkfw::Text part;
+    while (input->next(part)) {
+      auto arena = std::make_shared<wkfw::Arena>(budget);
+      batch = worker->execute(wkfw::WorkerResult(std::move(part))
+                                  .withArena(arena))
+                  .getValue();
+      if (!batch.empty())
+        return true;
+    }
+    return false;
+  }
+
+ private:
+  const LineWorker* worker;
+  std::unique_ptr<wkfw::Cursor> input;
+  std::shared_ptr<wkfw::MemoryBudget> budget;
+};
+
+std::unique_ptr<wkfw::Cursor> LineWorker::open(
+    std::unique_ptr<wkfw::Cursor> input,
+    std::shared_ptr<wkfw::MemoryBudget> budget) const
+    throw(wkfw::WorkerExecuteException) {
+  if (!input)
+    return wkfw::Worker::open(std::move(input), budget);
+  return std::unique_ptr<wkfw::Cursor>(
+      new LineCursor(this, std::move(input), budget));
+}
+
+/**
+ * Стандартный ввод и вывод разделяются всеми обработчиками.
+ */
+static std::mutex standardInputMutex;
+static std::mutex standardOutputMutex;
+
+/**
+ * Построчно читает стандартный ввод по мере поступления данных.
+ *
+ * @return false, если обработчик прервал чтение.
+ */
+static bool scanStandardInput(const std::function<bool(std::string&)>&
+                                  consumer) throw(wkfw::WorkerExecuteException) {
+  std::lock_guard<std::mutex> lock(standardInputMutex);
+  std::string line;
+  while (std::getline(std::cin, line))
+    if (!consumer(line))
+      return false;
+  if (std::cin.bad())
+    throw wkfw::WorkerExecuteException("Cannot read lines from standard input");
+  return true;
+}
+
+/**
+ * @return Размер файла в байтах.
+ */
+static uint64_t getFileSize(const std::string& filename) throw(
+    wkfw::WorkerExecuteException) {
+  struct stat info;
+  if (stat(filename.c_str(), &info) != 0)
+    throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
+                                       filename + "\"");
+  return info.st_size;
+}
+
+/**
+ * @return true, если файл - обычный файл, который можно читать с любого места,
+ * а не стандартный ввод, канал или устройство.
+ */
+static bool isRegularFile(const std::string& filename) {
+  struct stat info;
+  return filename != STANDARD_STREAM && stat(filename.c_str(), &info) == 0 &&
+         S_ISREG(info.st_mode);
+}
+
+/**
+ * Минимальный шаг роста буфера при чтении файла до конца.
+ */
+static const uint64_t READ_CHUNK_SIZE = 1 << 16;
+
+/**
+ * Размер блока, которым читаются файлы нескольких входов: при чтении
+ * в порядке готовности строки файлов чередуются такими блоками.
+ */
+static const uint64_t INTERLEAVE_BLOCK_SIZE = 1 << 20;
+
+/**
+ * Считывает первые size байт файла, а байты, дописанные в файл после
+ * определения его размера, - в rest.
+ *
+ * @param progress Получает количество считанных байт после каждого блока
+ * или пустой.
+ */
+static void readBytes(const std::string& filename,
+                      char* data,
+                      const uint64_t size,
+                      std::string& rest,
+                      const std::function<void(uint64_t)>& progress =
+                          nullptr) throw(wkfw::WorkerExecuteException) {
+  std::ifstream input(filename, std::ios::binary);
+  if (!input.is_open())
+    throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
+                                       filename + "\"");
+  for (uint64_t done = 0; done < size;) {
+    const uint64_t block = std::min(size - done, INTERLEAVE_BLOCK_SIZE);
+    if (!input.read(data + done, block))
+      throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
+                                         filename + "\"");
+    done += block;
+    if (progress)
+      progress(done);
+  }
+  rest.assign(std::istreambuf_iterator<char>(input),
+              std::istreambuf_iterator<char>());
+  if (input.bad())
+    throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
+                                       filename + "\"");
+}
+
+/**
+ * Считывает файл до конца в байты, выделенные в конце столбца строителя.
+ * Размер файла - лишь начальная оценка: каналы и подстановки процессов
+ * сообщают нулевой размер, а обычный файл может дописываться во время
+ * чтения.
+ *
+ * @return Количество считанных байт, строками их делает addLines.
+ */
+static uint64_t readAll(const std::string& filename,
+                        wkfw::TextBuilder& list) throw(
+    wkfw::WorkerExecuteException) {
+  std::ifstream input(filename, std::ios::binary);
+  if (!input.is_open())
+    throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
+                                       filename + "\"");
+
+  // Лишний байт сверх размера позволяет заметить конец файла без
+  // повторного выделения
+  uint64_t capacity =
+      std::max<uint64_t>(getFileSize(filename) + 1, READ_CHUNK_SIZE);
+  uint64_t size = 0;
+  char* data = list.reserveBytes(capacity);
+  while (input.read(data + size, capacity - size)) {
+    size = capacity;
+    capacity *= 2;
+    data = list.reserveBytes(capacity);
+  }
+  if (input.bad())
+    throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
+                                       filename + "\"");
+  return size + input.gcount();
+}
+
+/**
+ * Считывает все строки файла. Содержимое файла считывается целиком
+ * в столбец текста и делится на строки на месте.
+ *
+ * @param arena Арена исполнения или nullptr.
+ */
+static wkfw::Text readLines(const std::string& filename,
+                            std::shared_ptr<wkfw::Arena> arena) throw(
+    wkfw::WorkerExecuteException) {
+  wkfw::TextBuilder list(arena);
+
+  if (filename == STANDARD_STREAM) {
+    scanStandardInput([&list](std::string& line) {
+      list.add(line);
+      return true;
+    });
+    return list.build();
+  }
+
+  list.addLines(readAll(filename, list));
+  return list.build();
+}
+
+/**
+ * @return true, если имя файла - шаблон.
+ */
+static bool isPattern(const std::string& filename) {
+  return filename.find_first_of("*?[") != std::string::npos;
+}
+
+std::vector<std::string> ReadFile::getFilenames() const
+    throw(wkfw::WorkerExecuteException) {
+  std::vector<std::string> filenames;
+
+  for (auto const& pattern : patterns) {
+    if (!isPattern(pattern)) {
+      filenames.push_back(pattern);
+      continue;
+    }
+    glob_t found;
+    if (glob(pattern.c_str(), 0, nullptr, &found) != 0) {
+      globfree(&found);
+      throw wkfw::WorkerExecuteException("No files match pattern \"" +
+                                         pattern + "\"");
+    }
+    for (size_t i = 0; i < found.gl_pathc; i++)
+      filenames.push_back(found.gl_pathv[i]);
+    globfree(&found);
+  }
+
+  return filenames;
+}
+
+bool ReadFile::isSingleFile() const {
+  return patterns.size() == 1 && !isPattern(patterns.front());
+}
+
 const wkfw::WorkerResult ReadFile::execute(const wkfw::WorkerResult& previous)
     const throw(wkfw::WorkerExecuteException) {
-  std::ifstream input;
-  std::vector<std::string> list;
+  const std::vector<std::string> filenames = getFilenames();
+  if (filenames.size() == 1)
+    return wkfw::WorkerResult(
+        readLines(filenames.front(), previous.getArena()));
 
-  input.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+  // Файлы считываются в один столбец, каждый в свою часть. Размер
+  // стандартного ввода и каналов неизвестен заранее, поэтому они
+  // считываются сразу
+  std::vector<std::string> streamed(filenames.size());
+  std::vector<bool> buffered(filenames.size(), true);
+  std::vector<uint64_t> starts(filenames.size() + 1, 0);
+  for (size_t file = 0; file < filenames.size(); file++) {
+    uint64_t size;
+    if (filenames[file] == STANDARD_STREAM) {
+      scanStandardInput([&streamed, file](std::string& line) {
+        streamed[file] += line + '\n';
+        return true;
+      });
+      size = streamed[file].size();
+    } else if (!isRegularFile(filenames[file])) {
+      readBytes(filenames[file], nullptr, 0, streamed[file]);
+      size = streamed[file].size();
+    } else {
+      size = getFileSize(filenames[file]);
+      buffered[file] = false;
+    }
+    starts[file + 1] = starts[file] + size;
+  }
 
-  try {
-    input.open(filename);
+  wkfw::TextBuilder list(previous.getArena());
+  char* data = list.reserveBytes(starts.back());
+
+  // Файлы читаются параллельно, каждый поток берет следующий файл.
+  // Для чтения в порядке готовности запоминается, сколько байт какого
+  // файла считано, в порядке поступления блоков
+  const uint64_t whole = std::numeric_limits<uint64_t>::max();
+  std::vector<std::pair<size_t, uint64_t>> arrived;
+  std::atomic<size_t> next(0);
+  std::mutex mutex;
+  std::string error;
+
+  auto read = [&]() {
+    size_t file;
+    while ((file = next++) < filenames.size()) {
+      try {
+        const uint64_t size = starts[file + 1] - starts[file];
+        std::function<void(uint64_t)> progress;
+        if (mode == Mode::INTERLEAVE)
+          progress = [&arrived, &mutex, file](uint64_t done) {
+            std::lock_guard<std::mutex> lock(mutex);
+            arrived.push_back(std::make_pair(file, done));
+          };
+        if (buffered[file])
+          memcpy(data + starts[file], streamed[file].data(), size);
+        else
+          readBytes(filenames[file], data + starts[file], size,
+                    streamed[file], progress);
+        std::lock_guard<std::mutex> lock(mutex);
+        arrived.push_back(std::make_pair(file, whole));
+      } catch (const std::exception& e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error == "")
+          error = e.what();
+      }
+    }
+  };
+
+  const size_t threads = std::min<size_t>(
+      filenames.size(),
+      std::max<size_t>(READ_THREADS, std::thread::hardware_concurrency()));
+  std::vector<std::thread> readers;
+  for (size_t i = 1; i < threads; i++)
+    readers.push_back(std::thread(read));
+  read();
+  for (auto& reader : readers)
+    reader.join();
+
+  if (error != "")
+    throw wkfw::WorkerExecuteException(error);
+
+  // Файлы, дописанные во время чтения, не помещаются в свои части:
+  // части раскладываются заново вместе с дописанными байтами
+  bool grown = false;
+  for (size_t file = 0; file < filenames.size(); file++)
+    grown = grown || (!buffered[file] && !streamed[file].empty());
+  if (grown) {
+    std::vector<uint64_t> moved(filenames.size() + 1, 0);
+    for (size_t file = 0; file < filenames.size(); file++)
+      moved[file + 1] = moved[file] + starts[file + 1] - starts[file] +
+                        (buffered[file] ? 0 : streamed[file].size());
+
+    wkfw::TextBuilder relaid(previous.getArena());
+    char* bytes = relaid.reserveBytes(moved.back());
+    for (size_t file = 0; file < filenames.size(); file++) {
+      const uint64_t size = starts[file + 1] - starts[file];
+      memcpy(bytes + moved[file], data + starts[file], size);
+      if (!buffered[file])
+        memcpy(bytes + moved[file] + size, streamed[file].data(),
+               streamed[file].size());
+    }
+    list = std::move(relaid);
+    starts = moved;
+  }
+
+  // Строки каждого файла идут подряд, начиная с first[file]
+  std::vector<size_t> first(filenames.size() + 1, 0);
+  for (size_t file = 0; file < filenames.size(); file++) {
+    list.addLines(starts[file + 1] - starts[file]);
+    first[file + 1] = list.size();
+  }
+  wkfw::Text text = list.build();
+  if (mode == Mode::CONCAT)
+    return wkfw::WorkerResult(std::move(text));
+
+  // Чередование и слияние - выборки из общего столбца
+  if (mode == Mode::INTERLEAVE) {
+    // Каждый блок добавляет строки своего файла, завершенные в нем
+    std::vector<size_t> kept(first.begin(), first.end() - 1);
+    for (auto const& block : arrived) {
+      const size_t file = block.first;
+      for (; kept[file] < first[file + 1]; kept[file]++) {
+        const wkfw::Line line = text[kept[file]];
+        const uint64_t end = line.data + line.size - text[first[file]].data;
+        if (block.second != whole && end >= block.second)
+          break;
+        list.keep(text, kept[file]);
+      }
+    }
+  } else if (mode == Mode::MERGE) {
+    // Слияние k отсортированных текстов через кучу их текущих строк,
+    // из равных строк первой идет строка более раннего файла
+    typedef std::pair<size_t, size_t> Position;  // Файл и строка
+    auto later = [&text](const Position& a, const Position& b) {
+      int order = text[a.second].compare(text[b.second]);
+      return order > 0 || (order == 0 && b.first < a.first);
+    };
+    std::priority_queue<Position, std::vector<Position>, decltype(later)>
+        heap(later);
+    for (size_t file = 0; file < filenames.size(); file++)
+      if (first[file] < first[file + 1])
+        heap.push(Position(file, first[file]));
+
+    while (!heap.empty()) {
+      const Position top = heap.top();
+      heap.pop();
+      list.keep(text, top.second);
+      if (top.second + 1 < first[top.first + 1])
+        heap.push(Position(top.first, top.second + 1));
+    }
+  }
+
+  return wkfw::WorkerResult(list.build());
+}
+
+const wkfw::WorkerResult ReadFile::readFrom(const uint64_t offset,
+                                           uint64_t& end) const
+    throw(wkfw::WorkerExecuteException) {
+  const std::string& filename = getFilename();
+  std::ifstream input(filename, std::ios::binary);
+  wkfw::TextBuilder list;
+
+  if (!input.is_open())
+    throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
+                                       filename + "\"");
+
+  input.seekg(0, std::ios::end);
+  const uint64_t size = input.tellg();
+  if (size < offset)
+    throw wkfw::WorkerExecuteException("File \"" + filename +
+                                       "\" is shorter than expected.");
+
+  const size_t length = size - offset;
+  char* data = list.reserveBytes(length);
+  input.seekg(offset);
+  if (length > 0 && !input.read(data, length))
+    throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
+                                       filename + "\"");
+
+  // Незавершенная последняя строка останется для следующего чтения
+  const char* last = (const char*)memrchr(data, '\n', length);
+  const size_t complete = last != nullptr ? last - data + 1 : 0;
+  list.addLines(complete);
+  end = offset + complete;
+
+  return wkfw::WorkerResult(list.build());
+}
+
+/**
+ * Потоковое чтение одного файла (см. ReadFile::scan).
+ *
+ * @return false, если обработчик прервал чтение.
+ */
+static bool scanFile(const std::string& filename,
+                     const std::function<bool(std::string&)>& consumer,
+                     const bool backward) throw(wkfw::WorkerExecuteException) {
+  if (filename == STANDARD_STREAM && !backward)
+    return scanStandardInput(consumer);
+
+  // Стандартный ввод и каналы нельзя читать с конца, они считываются целиком
+  if (backward && !isRegularFile(filename)) {
+    wkfw::TextBuilder list;
+    scanFile(filename,
+             [&list](std::string& line) {
+               list.add(line);
+               return true;
+             },
+             false);
+    const wkfw::Text lines = list.build();
+    for (size_t i = lines.size(); i-- > 0;) {
+      std::string line = lines[i].str();
+      if (!consumer(line))
+        return false;
+    }
+    return true;
+  }
+
+  std::ifstream input(filename, std::ios::binary);
+  if (!input.is_open())
+    throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
+                                       filename + "\"");
+
+  if (!backward) {
     std::string line;
-    while (!input.eof() && std::getline(input, line))
-      list.push_back(line);
-    input.close();
-  } catch (std::ifstream::failure& e) {
-    if (!input.eof())
+    while (std::getline(input, line))
+      if (!consumer(line))
+        return false;
+    if (input.bad())
+      throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
+                                         filename + "\"");
+    return true;
+  }
+
+  const uint64_t BLOCK_SIZE = 1 << 16;
+  input.seekg(0, std::ios::end);
+  uint64_t position = input.tellg();
+  bool last = true;
+  // Части еще не завершенной строки, начиная с ближайшей к концу файла.
+  // Они склеиваются один раз, когда найдено начало строки
+  std::vector<std::string> pending;
+  std::string block;
+
+  while (position > 0) {
+    const uint64_t size = std::min(position, BLOCK_SIZE);
+    position -= size;
+    block.resize(size);
+    input.seekg(position);
+    if (!input.read(&block[0], size))
       throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
                                          filename + "\"");
+
+    // Перенос строки в конце файла не начинает новую строку
+    size_t end = size;
+    if (last && block[end - 1] == '\n')
+      end--;
+    last = false;
+
+    const char* found;
+    while ((found = (const char*)memrchr(block.data(), '\n', end)) !=
+           nullptr) {
+      std::string line(found + 1, block.data() + end);
+      for (auto part = pending.rbegin(); part != pending.rend(); ++part)
+        line += *part;
+      pending.clear();
+      if (!consumer(line))
+        return false;
+      end = found - block.data();
+    }
+    pending.push_back(block.substr(0, end));
   }
 
-  return wkfw::WorkerResult(list);
+  if (last)
+    return true;
+  std::string line;
+  for (auto part = pending.rbegin(); part != pending.rend(); ++part)
+    line += *part;
+  return consumer(line);
 }
 
-const wkfw::WorkerResult WriteFile::execute(const wkfw::WorkerResult& previous)
-    const throw(wkfw::WorkerExecuteException) {
+void ReadFile::scan(const std::function<bool(std::string&)>& consumer,
+                    const bool backward) const
+    throw(wkfw::WorkerExecuteException) {
+  std::vector<std::string> filenames = getFilenames();
+  if (backward)
+    std::reverse(filenames.begin(), filenames.end());
+
+  for (auto const& filename : filenames)
+    if (!scanFile(filename, consumer, backward))
+      return;
+}
+
+/**
+ * Размер блока ленивого чтения файла.
+ */
+static const size_t READ_BLOCK_SIZE = 4 << 20;
+
+/**
+ * Ленивое чтение файлов (см. ReadFile::open).
+ */
+class ReadCursor : public wkfw::Cursor {
+ public:
+  ReadCursor(const std::vector<std::string>& filenames,
+             std::shared_ptr<wkfw::MemoryBudget> budget)
+      : filenames(filenames), budget(budget), current(0), input(nullptr) {}
+
+  bool next(wkfw::Text& batch) throw(wkfw::WorkerExecuteException) override {
+    while (current < filenames.size()) {
+      const std::string& filename = filenames[current];
+      if (input == nullptr)
+        openFile(filename);
+
+      // Незавершенная строка прошлого блока переносится в начало
+      // следующего, блок растет вместе с ней
+      const size_t block = std::max(READ_BLOCK_SIZE, pending.size());
+      wkfw::TextBuilder list(std::make_shared<wkfw::Arena>(budget));
+      char* data = list.reserveBytes(pending.size() + block);
+      memcpy(data, pending.data(), pending.size());
+      const size_t length = pending.size() + readBlock(data + pending.size(),
+                                                       block, filename);
+      const bool finished = length < pending.size() + block;
+
+      size_t complete = length;
+      if (!finished) {
+        const char* last = (const char*)memrchr(data, '\n', length);
+        complete = last != nullptr ? last - data + 1 : 0;
+      }
+      pending.assign(data + complete, length - complete);
+      if (finished) {
+        file.close();
+        input = nullptr;
+        current++;
+      }
+
+      if (complete > 0) {
+        list.addLines(complete);
+        batch = list.build();
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  const std::vector<std::string> filenames;
+  std::shared_ptr<wkfw::MemoryBudget> budget;
+  size_t current;
+  std::ifstream file;
+  std::istream* input;
+  std::string pending;
+
+  void openFile(const std::string& filename) throw(
+      wkfw::WorkerExecuteException) {
+    if (filename == STANDARD_STREAM) {
+      input = &std::cin;
+      return;
+    }
+    file.open(filename, std::ios::binary);
+    if (!file.is_open())
+      throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
+                                         filename + "\"");
+    input = &file;
+  }
+
+  /**
+   * @return Количество считанных байт, меньше size - в конце файла.
+   */
+  size_t readBlock(char* data, const size_t size, const std::string& filename)
+      throw(wkfw::WorkerExecuteException) {
+    std::unique_lock<std::mutex> lock(standardInputMutex, std::defer_lock);
+    if (input == &std::cin)
+      lock.lock();
+    input->read(data, size);
+    if (input->bad())
+      throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
+                                         filename + "\"");
+    return input->gcount();
+  }
+};
+
+std::unique_ptr<wkfw::Cursor> ReadFile::open(
+    std::unique_ptr<wkfw::Cursor> input,
+    std::shared_ptr<wkfw::MemoryBudget> budget) const
+    throw(wkfw::WorkerExecuteException) {
+  if (mode != Mode::CONCAT)
+    return wkfw::Worker::open(std::move(input), budget);
+  return std::unique_ptr<wkfw::Cursor>(new ReadCursor(getFilenames(), budget));
+}
+
+/**
+ * @return Размер, время изменения и имя файла или пустая строка,
+ * если файла нет.
+ */
+static std::string describeFile(const std::string& filename) {
+  struct stat info;
+  if (stat(filename.c_str(), &info) != 0)
+    return "";
+
+  return std::to_string(info.st_size) + " " +
+         std::to_string(info.st_mtim.tv_sec) + "." +
+         std::to_string(info.st_mtim.tv_nsec) + " " + filename;
+}
+
+std::string ReadFile::getFingerprint() const {
+  if (mode == Mode::INTERLEAVE)
+    return "";
+
+  std::string fingerprint = "readfile";
+  if (mode == Mode::MERGE)
+    fingerprint += " --merge";
+  try {
+    for (auto const& filename : getFilenames()) {
+      const std::string description = describeFile(filename);
+      if (description == "")
+        return "";
+      fingerprint += " " + description;
+    }
+  } catch (const wkfw::WorkerExecuteException& e) {
+    return "";
+  }
+  return fingerprint;
+}
+
+/**
+ * Размер буфера, в котором собираются строки выборки перед выводом.
+ */
+static const size_t OUTPUT_BUFFER_SIZE = 1 << 20;
+
+/**
+ * Выводит строки текста в поток. Столбец без выборки выводится
+ * одной записью, строки выборки собираются в буфер.
+ */
+static void putLines(std::ostream& output, const wkfw::Text& text) {
+  const wkfw::TextColumn* column = text.getColumn();
+  if (column != nullptr && !text.isSelection() && column->isTerminated()) {
+    output.write(column->getBytes(), column->getLength());
+    if (column->getBytes()[column->getLength() - 1] != '\n')
+      output << '\n';
+    return;
+  }
+
+  std::string buffer;
+  buffer.reserve(OUTPUT_BUFFER_SIZE);
+  for (auto const& line : text) {
+    buffer.append(line.data, line.size);
+    buffer += '\n';
+    if (buffer.size() >= OUTPUT_BUFFER_SIZE) {
+      output.write(buffer.data(), buffer.size());
+      buffer.clear();
+    }
+  }
+  output.write(buffer.data(), buffer.size());
+}
+
+/**
+ * Записывает строки текста в файл.
+ *
+ * @param mode Режим открытия файла.
+ */
+static void writeLines(const std::string& filename,
+                       const wkfw::WorkerResult& text,
+                       std::ios::openmode mode) throw(
+    wkfw::WorkerExecuteException) {
+  if (filename == STANDARD_STREAM) {
+    std::lock_guard<std::mutex> lock(standardOutputMutex);
+    putLines(std::cout, text.getValue());
+    if (!std::cout.flush())
+      throw wkfw::WorkerExecuteException(
+          "Cannot write lines to standard output");
+    return;
+  }
+
   std::ofstream output;
 
   output.exceptions(std::ofstream::failbit | std::ofstream::badbit);
 
   try {
-    output.open(filename);
-    for (auto const& line : previous.getValue())
-      output << line << std::endl;
+    output.open(filename, mode);
+    putLines(output, text.getValue());
     output.close();
   } catch (std::ofstream::failure& e) {
     throw wkfw::WorkerExecuteException("Cannot write lines to file \"" +
                                        filename + "\"");
   }
+}
+
+const wkfw::WorkerResult WriteFile::execute(const wkfw::WorkerResult& previous)
+    const throw(wkfw::WorkerExecuteException) {
+  writeLines(filename, previous, std::ios::out);
 
   return wkfw::WorkerResult();
 }
 
-const wkfw::WorkerResult Grep::execute(const wkfw::WorkerResult& previous) const
+void WriteFile::append(const wkfw::WorkerResult& previous) const
     throw(wkfw::WorkerExecuteException) {
-  std::vector<std::string> list;
+  writeLines(filename, previous, std::ios::out | std::ios::app);
+}
 
-  for (auto const& line : previous.getValue())
-    if (line.find(pattern) != -1)
-      list.push_back(line);
+/**
+ * Ленивая запись в файл (см. WriteFile::open).
+ */
+class WriteCursor : public wkfw::Cursor {
+ public:
+  WriteCursor(const std::string& filename, std::unique_ptr<wkfw::Cursor> input)
+      : filename(filename), input(std::move(input)), output(nullptr) {}
 
-  return wkfw::WorkerResult(list);
-}
+  bool next(wkfw::Text&) throw(wkfw::WorkerExecuteException) override {
+    try {
+      if (output == nullptr)
+        openFile();
 
-const wkfw::WorkerResult Sort::execute(const wkfw::WorkerResult& previous) const
+      wkfw::Text part;
+      if (!input->next(part)) {
+        if (file.is_open())
+          file.close();
+        return false;
+      }
+
+      if (output == &std::cout) {
+        std::lock_guard<std::mutex> lock(standardOutputMutex);
+        putLines(std::cout, part);
+        if (!std::cout.flush())
+          throw wkfw::WorkerExecuteException(
+              "Cannot write lines to standard output");
+      } else {
+        putLines(file, part);
+      }
+      return true;
+    } catch (std::ofstream::failure& e) {
+      throw wkfw::WorkerExecuteException("Cannot write lines to file \"" +
+                                         filename + "\"");
+    }
+  }
+
+ private:
+  const std::string filename;
+  std::unique_ptr<wkfw::Cursor> input;
+  std::ofstream file;
+  std::ostream* output;
+
+  void openFile() {
+    if (filename == STANDARD_STREAM) {
+      output = &std::cout;
+      return;
+    }
+    file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+    file.open(filename, std::ios::out);
+    output = &file;
+  }
+};
+
+std::unique_ptr<wkfw::Cursor> WriteFile::open(
+    std::unique_ptr<wkfw::Cursor> input,
+    std::shared_ptr<wkfw::MemoryBudget> budget) const
     throw(wkfw::WorkerExecuteException) {
-  std::vector<std::string> list = previous.getValue();
+  if (!input)
+    return wkfw::Worker::open(std::move(input), budget);
+  return std::unique_ptr<wkfw::Cursor>(
+      new WriteCursor(getFilename(), std::move(input)));
+}
+
+/**
+ * Наибольшее количество потоков записи частей.
+ */
+static const size_t WRITE_THREADS = 64;
+
+/**
+ * Размер буфера записи одной части.
+ */
+static const size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+const wkfw::WorkerResult Split::execute(const wkfw::WorkerResult& previous)
+    const throw(wkfw::WorkerExecuteException) {
+  const wkfw::Text& text = previous.getValue();
+
+  // Номера строк каждой части
+  std::vector<std::vector<uint32_t>> members(shards);
+  if (mode == Mode::HASH) {
+    const wkfw::FieldIndex* fields =
+        field > 0 ? &previous.getFields() : nullptr;
+    std::vector<uint32_t> targets(text.size());
+    const size_t parts = countPartitions(text.size());
+    forEachPartition(text.size(), parts, [&](size_t, size_t begin,
+                                             size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        uint64_t hash;
+        if (fields == nullptr) {
+          hash = wkfw::hashBytes(text[i].data, text[i].size);
+        } else if (fields->getCount(i) < field) {
+          hash = wkfw::hashBytes("", 0);
+        } else {
+          wkfw::FieldSpan span = fields->getField(i, field);
+          hash = wkfw::hashBytes(text[i].data + span.begin, span.size());
+        }
+        targets[i] = hash % shards;
+      }
+    });
+    for (size_t i = 0; i < text.size(); i++)
+      members[targets[i]].push_back(i);
+  } else {
+    uint64_t total = 0;
+    for (auto const& line : text)
+      total += line.size + 1;
+    uint64_t written = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+      members[std::min<uint64_t>(written * shards / total, shards - 1)]
+          .push_back(i);
+      written += text[i].size + 1;
+    }
+  }
+
+  // Каждый поток записывает следующую еще не записанную часть
+  std::vector<char> failed(shards, false);
+  std::atomic<size_t> next(0);
+  auto write = [&]() {
+    size_t shard;
+    std::string buffer;
+    while ((shard = next++) < shards) {
+      std::ofstream output(getShardFilename(shard), std::ios::binary);
+      buffer.clear();
+      for (auto line : members[shard]) {
+        buffer.append(text[line].data, text[line].size);
+        buffer += '\n';
+        if (buffer.size() >= WRITE_BUFFER_SIZE) {
+          output.write(buffer.data(), buffer.size());
+          buffer.clear();
+        }
+      }
+      output.write(buffer.data(), buffer.size());
+      output.close();
+      failed[shard] = !output;
+    }
+  };
 
-  std::sort(list.begin(), list.end());
+  std::vector<std::thread> writers;
+  for (size_t i = 1; i < std::min(shards, WRITE_THREADS); i++)
+    writers.push_back(std::thread(write));
+  write();
+  for (auto& writer : writers)
+    writer.join();
 
-  return wkfw::WorkerResult(list);
+  for (size_t shard = 0; shard < shards; shard++)
+    if (failed[shard])
+      throw wkfw::WorkerExecuteException("Cannot write lines to file \"" +
+                                         getShardFilename(shard) + "\"");
+
+  return wkfw::WorkerResult();
 }
 
 /**
- * Заменяет подстроки в с троке.
- *
- * @param str Исходная строка
- * @param pattern Паттерн для замены
- * @param substitution Замена для паттерна
- *
- * @return Строка с примененными заменами.
+ * Во сколько раз строк столбца в просматриваемом диапазоне может быть
+ * больше, чем строк выборки, чтобы grep просматривал байты подряд.
  */
-static std::string replace(const std::string& str,
-                           const std::string& pattern,
-                           const std::string& substitution) {
-  std::string result(str);
-  size_t index = 0;
-  while (true) {
-    index = str.find(pattern, index);
-    if (index == std::string::npos)
-      break;
-    result.replace(index, pattern.size(), substitution);
-    index += substitution.size();
+static const size_t DENSE_SELECTION = 8;
+
+void Grep::processBatch(const wkfw::WorkerResult& previous,
+                        const size_t begin,
+                        const size_t end,
+                        wkfw::TextBuilder& output) const {
+  const wkfw::Text& text = previous.getValue();
+  if (begin == end)
+    return;
+
+  // Байты столбца просматриваются подряд от первой до последней строки
+  // порции, вхождение относится к строке, в которой начинается. Редкие
+  // строки выборки быстрее проверить по одной
+  const wkfw::TextColumn* column = text.getColumn();
+  const size_t first = text.getPosition(begin);
+  const size_t last = text.getPosition(end - 1);
+  if (!pattern.empty() && text.isOrdered() &&
+      (end - begin) * DENSE_SELECTION > last - first) {
+    const char* bytes = column->getBytes();
+    const uint64_t limit = column->getOffset(last + 1);
+    size_t line = first;
+    size_t next = begin;
+    uint64_t from = column->getOffset(first);
+    const char* found;
+    while (from < limit &&
+           (found = wkfw::findBytes(bytes + from, limit - from, pattern)) !=
+               nullptr) {
+      const uint64_t position = found - bytes;
+      line = column->findLine(position, line);
+      if (position + pattern.size() >
+          column->getOffset(line) + (*column)[line].size) {
+        from = position + 1;
+        continue;
+      }
+      // Вхождение в строке вне выборки: просмотр продолжается
+      // со следующей строки выборки
+      while (text.getPosition(next) < line)
+        next++;
+      if (text.getPosition(next) == line)
+        output.keep(text, next++);
+      if (next == end)
+        break;
+      line = text.getPosition(next);
+      from = column->getOffset(line);
+    }
+    return;
   }
-  return result;
+
+  for (size_t i = begin; i < end; i++)
+    if (text[i].find(pattern) != std::string::npos)
+      output.keep(text, i);
 }
 
-const wkfw::WorkerResult Replace::execute(const wkfw::WorkerResult& previous)
-    const throw(wkfw::WorkerExecuteException) {
-  std::vector<std::string> list;
+std::string Grep::getFingerprint() const {
+  return "grep " + pattern;
+}
 
-  for (auto const& line : previous.getValue())
-    list.push_back(replace(line, pattern, substitution));
+/**
+ * Номер строки с ключом сортировки.
+ */
+struct KeyedLine {
+  const char* key;
+  size_t size;
+  size_t line;
+};
+
+/**
+ * Двоичный ключ числа в начале текста (ведущие пробелы пропускаются):
+ * беззнаковые ключи упорядочены так же, как числа. Текст без числа - 0.
+ *
+ * @param human Учитывать суффикс размера K, M, G, T, P, E (степени 1024).
+ */
+static uint64_t numericKey(const char* data, const size_t size, bool human) {
+  size_t position = 0;
+  while (position < size && (data[position] == ' ' || data[position] == '\t'))
+    position++;
+
+  // Копируем только подходящие символы: знак, цифры, дробная часть
+  char number[64];
+  size_t length = 0;
+  if (position < size && data[position] == '-')
+    number[length++] = data[position++];
+  bool point = false;
+  while (position < size && length + 1 < sizeof(number) &&
+         (isdigit((unsigned char)data[position]) ||
+          (data[position] == '.' && !point))) {
+    point = point || data[position] == '.';
+    number[length++] = data[position++];
+  }
+  number[length] = '\0';
+  double value = std::strtod(number, nullptr);
+
+  static const std::string SUFFIXES = "KMGTPE";
+  if (human && position < size) {
+    size_t suffix = SUFFIXES.find(toupper((unsigned char)data[position]));
+    if (suffix != std::string::npos)
+      value *= std::pow(1024.0, suffix + 1);
+  }
+
+  // Отрицательные числа: все биты инвертируются, положительные: знаковый бит
+  value += 0.0;  // -0.0 равен 0.0
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return (bits >> 63) ? ~bits : bits | (1ULL << 63);
+}
+
+/**
+ * Ключ номера версии: последовательности цифр без ведущих нулей предваряются
+ * их длиной, поэтому побайтовое сравнение ключей сравнивает их как числа.
+ * Длина записывается количеством своих байт и затем самими байтами
+ * от старшего, поэтому сравнение верно для последовательностей любой длины.
+ */
+static std::string versionKey(const char* data, const size_t size) {
+  std::string key;
+  key.reserve(size + 8);
+
+  for (size_t position = 0; position < size;) {
+    if (!isdigit((unsigned char)data[position])) {
+      key.push_back(data[position++]);
+      continue;
+    }
+    while (position + 1 < size && data[position] == '0' &&
+           isdigit((unsigned char)data[position + 1]))
+      position++;
+    size_t end = position;
+    while (end < size && isdigit((unsigned char)data[end]))
+      end++;
+    const uint64_t length = end - position;
+    char bytes = 1;
+    while (bytes < 8 && (length >> (8 * bytes)) != 0)
+      bytes++;
+    key.push_back(bytes);
+    for (char byte = bytes; byte-- > 0;)
+      key.push_back((char)(length >> (8 * byte)));
+    key.append(data + position, end - position);
+    position = end;
+  }
+
+  return key;
+}
+
+/**
+ * @return Первые восемь байт ключа от старшего, недостающие - нули:
+ * порядок префиксов не противоречит побайтовому порядку ключей.
+ */
+static uint64_t keyPrefix(const std::string& key) {
+  uint64_t prefix = 0;
+  for (size_t i = 0; i < 8; i++)
+    prefix = (prefix << 8) | (i < key.size() ? (unsigned char)key[i] : 0);
+  return prefix;
+}
+
+/**
+ * Поразрядная сортировка пар (ключ, номер строки) по ключу, устойчивая.
+ * Разряды, одинаковые у всех ключей, пропускаются.
+ */
+static void radixSort(std::vector<std::pair<uint64_t, size_t>>& items) {
+  std::vector<std::pair<uint64_t, size_t>> buffer(items.size());
+
+  for (size_t shift = 0; shift < 64; shift += 8) {
+    size_t counts[256] = {0};
+    for (auto const& item : items)
+      counts[(item.first >> shift) & 0xFF]++;
+    if (items.empty() ||
+        counts[(items.front().first >> shift) & 0xFF] == items.size())
+      continue;
+
+    size_t offset = 0;
+    for (size_t digit = 0; digit < 256; digit++) {
+      const size_t count = counts[digit];
+      counts[digit] = offset;
+      offset += count;
+    }
+    for (auto const& item : items)
+      buffer[counts[(item.first >> shift) & 0xFF]++] = item;
+    items.swap(buffer);
+  }
+}
+
+std::vector<size_t> Sort::arrange(const wkfw::WorkerResult& previous) const {
+  const wkfw::Text& text = previous.getValue();
+  const wkfw::FieldIndex* fields = field != 0 ? &previous.getFields() : nullptr;
+  std::vector<size_t> arranged;
+  arranged.reserve(text.size());
+
+  // Ключ строки - поле или строка целиком
+  auto keyOf = [&](size_t i) {
+    const wkfw::Line line = text[i];
+    if (fields == nullptr)
+      return KeyedLine{line.data, line.size, i};
+    wkfw::FieldSpan span = fields->getField(i, field);
+    return KeyedLine{line.data + span.begin, span.size(), i};
+  };
+  auto byLine = [&](size_t a, size_t b) { return text[a] < text[b]; };
+
+  if (order == Order::NUMERIC || order == Order::HUMAN) {
+    // Ключи разбираются один раз, затем поразрядная сортировка
+    std::vector<std::pair<uint64_t, size_t>> keys(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+      KeyedLine keyed = keyOf(i);
+      keys[i] = std::make_pair(
+          numericKey(keyed.key, keyed.size, order == Order::HUMAN), i);
+    }
+    radixSort(keys);
+
+    // При равных ключах строки упорядочиваются целиком
+    std::vector<size_t> run;
+    for (size_t i = 0; i < keys.size();) {
+      size_t next = i + 1;
+      while (next < keys.size() && keys[next].first == keys[i].first)
+        next++;
+      run.clear();
+      for (size_t j = i; j < next; j++)
+        run.push_back(keys[j].second);
+      if (run.size() > 1)
+        std::sort(run.begin(), run.end(), byLine);
+      arranged.insert(arranged.end(), run.begin(), run.end());
+      i = next;
+    }
+    return arranged;
+  }
+
+  if (order == Order::VERSION) {
+    // Ключи переменной длины: поразрядная сортировка по их первым восьми
+    // байтам, затем строки с равными префиксами сравниваются по ключам
+    std::vector<std::string> versions(text.size());
+    std::vector<std::pair<uint64_t, size_t>> keys(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+      KeyedLine keyed = keyOf(i);
+      versions[i] = versionKey(keyed.key, keyed.size);
+      keys[i] = std::make_pair(keyPrefix(versions[i]), i);
+    }
+    radixSort(keys);
+
+    auto byVersion = [&](size_t a, size_t b) {
+      int result = versions[a].compare(versions[b]);
+      return result != 0 ? result < 0 : byLine(a, b);
+    };
+    std::vector<size_t> run;
+    for (size_t i = 0; i < keys.size();) {
+      size_t next = i + 1;
+      while (next < keys.size() && keys[next].first == keys[i].first)
+        next++;
+      run.clear();
+      for (size_t j = i; j < next; j++)
+        run.push_back(keys[j].second);
+      if (run.size() > 1)
+        std::sort(run.begin(), run.end(), byVersion);
+      arranged.insert(arranged.end(), run.begin(), run.end());
+      i = next;
+    }
+    return arranged;
+  }
+
+  std::vector<KeyedLine> keys;
+  keys.reserve(text.size());
+  for (size_t i = 0; i < text.size(); i++)
+    keys.push_back(keyOf(i));
+  // Без поля равные ключи означают равные строки
+  std::sort(keys.begin(), keys.end(),
+            [&](const KeyedLine& a, const KeyedLine& b) {
+              int result = memcmp(a.key, b.key, std::min(a.size, b.size));
+              if (result != 0)
+                return result < 0;
+              if (a.size != b.size)
+                return a.size < b.size;
+              return fields != nullptr && byLine(a.line, b.line);
+            });
+  for (auto const& key : keys)
+    arranged.push_back(key.line);
+  return arranged;
+}
+
+const wkfw::WorkerResult Sort::execute(const wkfw::WorkerResult& previous) const
+    throw(wkfw::WorkerExecuteException) {
+  const wkfw::Text& text = previous.getValue();
+  wkfw::TextBuilder list(previous.getArena());
+  list.reserve(text.size());
+
+  // Рабочая память: номера строк и их ключи
+  wkfw::MemoryBudget::Reservation reservation(
+      previous.getBudget(), text.size() * (sizeof(size_t) + sizeof(KeyedLine)));
+
+  // Сортируются номера строк, результат - выборка из столбца входа
+  const std::vector<size_t> arranged = arrange(previous);
+
+  if (collapse == Collapse::NONE) {
+    for (auto line : arranged)
+      list.keep(text, line);
+    return wkfw::WorkerResult(list.build());
+  }
+
+  // Одинаковые строки оказываются рядом, оставляем по одной из группы
+  for (size_t i = 0; i < arranged.size();) {
+    const wkfw::Line line = text[arranged[i]];
+    size_t next = i + 1;
+    while (next < arranged.size() && text[arranged[next]] == line)
+      next++;
+    if (collapse == Collapse::COUNT) {
+      const std::string count = std::to_string(next - i) + '\t';
+      char* counted = list.addLine(count.size() + line.size);
+      memcpy(counted, count.data(), count.size());
+      memcpy(counted + count.size(), line.data, line.size);
+    } else {
+      list.keep(text, arranged[i]);
+    }
+    i = next;
+  }
+
+  return wkfw::WorkerResult(list.build());
+}
+
+std::string Sort::getFingerprint() const {
+  std::string fingerprint = "sort";
+  if (field != 0)
+    fingerprint += " by " + std::to_string(field);
+  if (order == Order::NUMERIC)
+    fingerprint += " numeric";
+  else if (order == Order::HUMAN)
+    fingerprint += " human";
+  else if (order == Order::VERSION)
+    fingerprint += " version";
+  if (collapse == Collapse::UNIQUE)
+    fingerprint += " unique";
+  else if (collapse == Collapse::COUNT)
+    fingerprint += " count";
+  return fingerprint;
+}
+
+int Sort::compare(const wkfw::Line& a,
+                  const size_t skipA,
+                  const wkfw::Line& b,
+                  const size_t skipB) const {
+  const wkfw::Line restA(a.data + skipA, a.size - skipA);
+  const wkfw::Line restB(b.data + skipB, b.size - skipB);
+
+  if (field != 0 || order != Order::TEXT) {
+    wkfw::Line keyA = restA;
+    wkfw::Line keyB = restB;
+    if (field != 0) {
+      wkfw::FieldSpan spanA =
+          wkfw::FieldIndex::findField(restA.data, restA.size, field);
+      wkfw::FieldSpan spanB =
+          wkfw::FieldIndex::findField(restB.data, restB.size, field);
+      keyA = wkfw::Line(restA.data + spanA.begin, spanA.size());
+      keyB = wkfw::Line(restB.data + spanB.begin, spanB.size());
+    }
+
+    int result;
+    if (order == Order::NUMERIC || order == Order::HUMAN) {
+      const bool human = order == Order::HUMAN;
+      uint64_t numberA = numericKey(keyA.data, keyA.size, human);
+      uint64_t numberB = numericKey(keyB.data, keyB.size, human);
+      result = numberA < numberB ? -1 : (numberA > numberB ? 1 : 0);
+    } else if (order == Order::VERSION) {
+      result = versionKey(keyA.data, keyA.size)
+                   .compare(versionKey(keyB.data, keyB.size));
+    } else {
+      result = keyA.compare(keyB);
+    }
+    if (result != 0)
+      return result;
+  }
+  return restA.compare(restB);
+}
+
+wkfw::Text Sort::merge(const wkfw::Text& first,
+                       const wkfw::Text& second) const {
+  wkfw::TextBuilder merged;
+  merged.reserve(first.size() + second.size());
+
+  size_t a = 0;
+  size_t b = 0;
+  while (a < first.size() && b < second.size()) {
+    // Строки сравниваются без счетчиков "<количество>\t"
+    size_t skipA = 0;
+    size_t skipB = 0;
+    if (collapse == Collapse::COUNT) {
+      skipA = first[a].find("\t") + 1;
+      skipB = second[b].find("\t") + 1;
+    }
+
+    int order = compare(first[a], skipA, second[b], skipB);
+    if (order < 0 || (order == 0 && collapse == Collapse::NONE)) {
+      merged.keep(first, a++);
+    } else if (order > 0) {
+      merged.keep(second, b++);
+    } else {
+      if (collapse == Collapse::COUNT)
+        merged.add(std::to_string(std::strtoull(first[a].data, nullptr, 10) +
+                                  std::strtoull(second[b].data, nullptr, 10)) +
+                   first[a].str().substr(skipA - 1));
+      else
+        merged.keep(first, a);
+      a++;
+      b++;
+    }
+  }
+  for (; a < first.size(); a++)
+    merged.keep(first, a);
+  for (; b < second.size(); b++)
+    merged.keep(second, b);
+
+  return merged.build();
+}
+
+std::FILE* Sort::spill(const wkfw::Text& sorted) const
+    throw(wkfw::WorkerExecuteException) {
+  std::FILE* run = tmpfile();
+  if (run == nullptr)
+    throw wkfw::WorkerExecuteException("Cannot write sort run to disk.");
+
+  for (auto const& line : sorted) {
+    if (fwrite(line.data, 1, line.size, run) != line.size ||
+        fputc('\n', run) == EOF) {
+      fclose(run);
+      throw wkfw::WorkerExecuteException("Cannot write sort run to disk.");
+    }
+  }
+  return run;
+}
+
+/**
+ * Построчное чтение части внешней сортировки с ее начала.
+ */
+class RunReader {
+ public:
+  explicit RunReader(std::FILE* file)
+      : file(file), buffer(nullptr), capacity(0) {
+    rewind(file);
+  }
+  RunReader(const RunReader&) = delete;
+  RunReader& operator=(const RunReader&) = delete;
+
+  ~RunReader() { free(buffer); }
+
+  /**
+   * Считывает следующую строку в line.
+   *
+   * @return false, если строки закончились.
+   */
+  bool next() throw(wkfw::WorkerExecuteException) {
+    const ssize_t length = getline(&buffer, &capacity, file);
+    if (length <= 0) {
+      if (ferror(file))
+        throw wkfw::WorkerExecuteException("Cannot read sort run from disk.");
+      return false;
+    }
+    line = wkfw::Line(buffer, buffer[length - 1] == '\n' ? length - 1 : length);
+    return true;
+  }
+
+  wkfw::Line line;
+
+ private:
+  std::FILE* file;
+  char* buffer;
+  size_t capacity;
+};
+
+void Sort::mergeRuns(const std::vector<std::FILE*>& runs,
+                     const std::function<bool(std::string&)>& consumer) const
+    throw(wkfw::WorkerExecuteException) {
+  std::vector<std::unique_ptr<RunReader>> readers;
+  for (auto run : runs)
+    readers.emplace_back(new RunReader(run));
+
+  // Строки сравниваются без счетчиков "<количество>\t"
+  auto skip = [this](const wkfw::Line& line) -> size_t {
+    return collapse == Collapse::COUNT ? line.find("\t") + 1 : 0;
+  };
+
+  // Куча текущих строк частей, из равных строк первой идет строка
+  // более ранней части
+  auto greater = [&](const size_t a, const size_t b) {
+    const wkfw::Line& lineA = readers[a]->line;
+    const wkfw::Line& lineB = readers[b]->line;
+    const int order = compare(lineA, skip(lineA), lineB, skip(lineB));
+    return order != 0 ? order > 0 : a > b;
+  };
+  std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(
+      greater);
+  for (size_t run = 0; run < readers.size(); run++)
+    if (readers[run]->next())
+      heap.push(run);
+
+  // Последняя строка результата ждет, пока не закончатся равные ей
+  std::string pending;
+  size_t pendingSkip = 0;
+  uint64_t count = 0;
+  bool waiting = false;
+  auto flush = [&]() {
+    if (!waiting)
+      return true;
+    waiting = false;
+    std::string line = pending;
+    if (collapse == Collapse::COUNT)
+      line = std::to_string(count) + '\t' + pending.substr(pendingSkip);
+    return consumer(line);
+  };
+
+  while (!heap.empty()) {
+    const size_t run = heap.top();
+    heap.pop();
+    const wkfw::Line& line = readers[run]->line;
+    const size_t lineSkip = skip(line);
+    const uint64_t lineCount =
+        collapse == Collapse::COUNT ? std::strtoull(line.data, nullptr, 10)
+                                    : 1;
+
+    if (waiting && collapse != Collapse::NONE &&
+        compare(wkfw::Line(pending), pendingSkip, line, lineSkip) == 0) {
+      count += lineCount;
+    } else {
+      if (!flush())
+        return;
+      pending.assign(line.data, line.size);
+      pendingSkip = lineSkip;
+      count = lineCount;
+      waiting = true;
+    }
+
+    if (readers[run]->next())
+      heap.push(run);
+  }
+  flush();
+}
+
+const wkfw::WorkerResult Top::execute(const wkfw::WorkerResult& previous) const
+    throw(wkfw::WorkerExecuteException) {
+  const wkfw::Text& text = previous.getValue();
+
+  // В каждой части - куча из не более чем count наименьших строк
+  // вместе с их номерами
+  typedef std::pair<wkfw::Line, size_t> Candidate;
+  const size_t parts = countPartitions(text.size());
+  std::vector<std::vector<Candidate>> heaps(parts);
+  forEachPartition(text.size(), parts,
+                   [&](size_t part, size_t begin, size_t end) {
+                     std::vector<Candidate>& heap = heaps[part];
+                     heap.reserve(std::min(count, end - begin));
+                     for (size_t i = begin; i < end && count > 0; i++) {
+                       const Candidate line(text[i], i);
+                       if (heap.size() < count) {
+                         heap.push_back(line);
+                         std::push_heap(heap.begin(), heap.end());
+                       } else if (line < heap.front()) {
+                         std::pop_heap(heap.begin(), heap.end());
+                         heap.back() = line;
+                         std::push_heap(heap.begin(), heap.end());
+                       }
+                     }
+                   });
+
+  std::vector<Candidate> candidates = std::move(heaps[0]);
+  for (size_t part = 1; part < parts; part++)
+    candidates.insert(candidates.end(), heaps[part].begin(), heaps[part].end());
+  const size_t size = std::min(count, candidates.size());
+  std::partial_sort(candidates.begin(), candidates.begin() + size,
+                    candidates.end());
+
+  wkfw::TextBuilder list(previous.getArena());
+  list.reserve(size);
+  for (size_t i = 0; i < size; i++)
+    list.keep(text, candidates[i].second);
+
+  return wkfw::WorkerResult(list.build());
+}
+
+std::string Top::getFingerprint() const {
+  return "top " + std::to_string(count);
+}
+
+const wkfw::WorkerResult Head::execute(const wkfw::WorkerResult& previous) const
+    throw(wkfw::WorkerExecuteException) {
+  const wkfw::Text& text = previous.getValue();
+  wkfw::TextBuilder list(previous.getArena());
+
+  for (size_t i = 0; i < std::min(count, text.size()); i++)
+    list.keep(text, i);
+
+  return wkfw::WorkerResult(list.build());
+}
+
+/**
+ * Ленивое исполнение head (см. Head::open).
+ */
+class HeadCursor : public wkfw::Cursor {
+ public:
+  HeadCursor(const size_t count, std::unique_ptr<wkfw::Cursor> input)
+      : remaining(count), input(std::move(input)) {}
+
+  bool next(wkfw::Text& batch) throw(wkfw::WorkerExecuteException) override {
+    wkfw::Text part;
+    while (remaining > 0 && input->next(part)) {
+      if (part.size() <= remaining) {
+        remaining -= part.size();
+        batch = part;
+      } else {
+        wkfw::TextBuilder list;
+        for (size_t i = 0; i < remaining; i++)
+          list.keep(part, i);
+        remaining = 0;
+        batch = list.build();
+      }
+      if (!batch.empty())
+        return true;
+    }
+    return false;
+  }
+
+ private:
+  size_t remaining;
+  std::unique_ptr<wkfw::Cursor> input;
+};
+
+std::unique_ptr<wkfw::Cursor> Head::open(
+    std::unique_ptr<wkfw::Cursor> input,
+    std::shared_ptr<wkfw::MemoryBudget> budget) const
+    throw(wkfw::WorkerExecuteException) {
+  if (!input)
+    return wkfw::Worker::open(std::move(input), budget);
+  return std::unique_ptr<wkfw::Cursor>(new HeadCursor(count, std::move(input)));
+}
+
+std::string Head::getFingerprint() const {
+  return "head " + std::to_string(count);
+}
+
+const wkfw::WorkerResult Tail::execute(const wkfw::WorkerResult& previous) const
+    throw(wkfw::WorkerExecuteException) {
+  const wkfw::Text& text = previous.getValue();
+  wkfw::TextBuilder list(previous.getArena());
+
+  for (size_t i = text.size() - std::min(count, text.size()); i < text.size();
+       i++)
+    list.keep(text, i);
+
+  return wkfw::WorkerResult(list.build());
+}
+
+std::string Tail::getFingerprint() const {
+  return "tail " + std::to_string(count);
+}
+
+const wkfw::WorkerResult LimitedRead::execute(
+    const wkfw::WorkerResult& previous) const
+    throw(wkfw::WorkerExecuteException) {
+  std::vector<std::string> lines;
+  wkfw::TextBuilder list(previous.getArena());
+  if (count == 0)
+    return wkfw::WorkerResult(list.build());
+
+  // Прочитанные строки обрабатываются порциями, каждая в своей арене
+  std::unique_ptr<wkfw::TextBuilder> batch;
+  auto process = [&]() {
+    const wkfw::Text kept = applyLineWorkers(stages, batch->build(), nullptr);
+    batch.reset();
+    for (size_t i = 0; i < kept.size() && lines.size() < count; i++)
+      lines.push_back(kept[i].str());
+    return lines.size() < count;
+  };
+
+  bool reading = true;
+  reader->scan(
+      [&](std::string& line) {
+        if (!batch)
+          batch.reset(new wkfw::TextBuilder());
+        batch->add(line);
+        reading = batch->size() < BATCH_LINES || process();
+        return reading;
+      },
+      backward);
+  if (reading && batch)
+    process();
+
+  if (backward)
+    std::reverse(lines.begin(), lines.end());
+  list.reserve(lines.size());
+  for (auto const& line : lines)
+    list.add(line);
+  return wkfw::WorkerResult(list.build());
+}
+
+std::string LimitedRead::getFingerprint() const {
+  std::string fingerprint = reader->getFingerprint();
+  if (fingerprint == "")
+    return "";
+
+  for (auto stage : stages)
+    fingerprint += "\n" + stage->getFingerprint();
+  return fingerprint + (backward ? "\ntail " : "\nhead ") +
+         std::to_string(count);
+}
+
+void Cut::processBatch(const wkfw::WorkerResult& previous,
+                       const size_t begin,
+                       const size_t end,
+                       wkfw::TextBuilder& output) const {
+  const wkfw::Text& text = previous.getValue();
+  const wkfw::FieldIndex& index = previous.getFields();
+
+  // Длина результата известна заранее, строка собирается сразу в столбце
+  for (size_t i = begin; i < end; i++) {
+    size_t size = fields.size() - 1;
+    for (auto field : fields)
+      size += index.getField(i, field).size();
+
+    const wkfw::Line line = text[i];
+    char* position = output.addLine(size);
+    for (size_t j = 0; j < fields.size(); j++) {
+      wkfw::FieldSpan span = index.getField(i, fields[j]);
+      if (j > 0)
+        *position++ = '\t';
+      memcpy(position, line.data + span.begin, span.size());
+      position += span.size();
+    }
+  }
+}
+
+std::string Cut::getFingerprint() const {
+  std::string fingerprint = "cut";
+  for (auto field : fields)
+    fingerprint += " " + std::to_string(field);
+  return fingerprint;
+}
+
+bool FieldGrep::matches(const wkfw::Line& line,
+                        const wkfw::FieldSpan& span) const {
+  if (span.size() < pattern.size())
+    return false;
+  // Первое вхождение после начала поля должно закончиться внутри поля
+  size_t found = line.find(pattern, span.begin);
+  return found != std::string::npos && found + pattern.size() <= span.end;
+}
+
+void FieldGrep::processBatch(const wkfw::WorkerResult& previous,
+                             const size_t begin,
+                             const size_t end,
+                             wkfw::TextBuilder& output) const {
+  const wkfw::Text& text = previous.getValue();
+  const wkfw::FieldIndex& index = previous.getFields();
+
+  for (size_t i = begin; i < end; i++)
+    if (index.getCount(i) >= field && matches(text[i], index.getField(i, field)))
+      output.keep(text, i);
+}
+
+std::string FieldGrep::getFingerprint() const {
+  return "fieldgrep " + std::to_string(field) + " " + pattern;
+}
+
+/**
+ * Частичный результат группы. Ключ указывает в строку входного текста
+ * или в прочитанные с диска данные.
+ */
+struct Group {
+  uint64_t hash;
+  const char* key;
+  uint32_t size;
+  uint64_t count;  // 0 - пустая ячейка таблицы
+  double value;
+};
+
+/**
+ * Хэш-таблица групп с открытой адресацией.
+ */
+class GroupTable {
+ public:
+  explicit GroupTable(const Aggregate::Operation operation)
+      : operation(operation), slots(64, Group{0, nullptr, 0, 0, 0}), used(0) {}
+
+  /**
+   * Добавляет к группе частичный результат.
+   */
+  void add(const Group& group) {
+    if ((used + 1) * 2 > slots.size())
+      grow();
+
+    const size_t mask = slots.size() - 1;
+    size_t slot = group.hash & mask;
+    while (slots[slot].count != 0 &&
+           (slots[slot].hash != group.hash || slots[slot].size != group.size ||
+            memcmp(slots[slot].key, group.key, group.size) != 0))
+      slot = (slot + 1) & mask;
+
+    Group& current = slots[slot];
+    if (current.count == 0) {
+      current = group;
+      used++;
+      return;
+    }
+    current.count += group.count;
+    if (operation == Aggregate::Operation::SUM)
+      current.value += group.value;
+    else if (operation == Aggregate::Operation::MIN)
+      current.value = std::min(current.value, group.value);
+    else if (operation == Aggregate::Operation::MAX)
+      current.value = std::max(current.value, group.value);
+  }
+
+  /**
+   * @return Объем памяти таблицы в байтах.
+   */
+  size_t memory() const { return slots.size() * sizeof(Group); }
+
+  const std::vector<Group>& getSlots() const { return slots; }
+
+  void clear() {
+    slots.assign(64, Group{0, nullptr, 0, 0, 0});
+    used = 0;
+  }
+
+ private:
+  const Aggregate::Operation operation;
+  std::vector<Group> slots;
+  size_t used;
+
+  void grow() {
+    std::vector<Group> old(slots.size() * 2, Group{0, nullptr, 0, 0, 0});
+    old.swap(slots);
+    used = 0;
+    for (auto const& group : old)
+      if (group.count != 0)
+        add(group);
+  }
+};
+
+/**
+ * Записывает число без лишних нулей: целые - без дробной части.
+ */
+static std::string formatNumber(const double value) {
+  if (value == (double)(int64_t)value && std::fabs(value) < 1e15)
+    return std::to_string((int64_t)value);
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.15g", value);
+  return buffer;
+}
+
+/**
+ * Количество разделов при сбросе групп на диск.
+ */
+static const size_t SPILL_PARTITIONS = 16;
+
+/**
+ * Количество уровней разделения: раздел, не поместившийся в бюджет
+ * при слиянии, делится на разделы следующего уровня.
+ */
+static const size_t SPILL_LEVELS = 8;
+
+/**
+ * Наименьший бюджет таблицы групп: при меньшем таблица сбрасывалась бы
+ * на диск после каждой строки.
+ */
+static const size_t MIN_GROUP_TABLE_MEMORY = 64 << 10;
+
+/**
+ * @return Раздел группы на уровне разделения: очередные четыре старших бита
+ * хэша, младшие выбирают ячейку таблицы.
+ */
+static size_t spillPartition(const uint64_t hash, const size_t level) {
+  return (hash >> (60 - 4 * level)) % SPILL_PARTITIONS;
+}
+
+/**
+ * Временные файлы сброшенных на диск групп, по одному на раздел.
+ * Удаляются системой при закрытии.
+ */
+class SpillFiles {
+ public:
+  explicit SpillFiles(const size_t level)
+      : level(level), files(SPILL_PARTITIONS, nullptr) {}
+  SpillFiles(const SpillFiles&) = delete;
+  SpillFiles& operator=(const SpillFiles&) = delete;
+
+  ~SpillFiles() {
+    for (auto file : files)
+      if (file != nullptr)
+        fclose(file);
+  }
+
+  /**
+   * Записывает все группы таблицы в файлы их разделов.
+   *
+   * @return false при ошибке записи.
+   */
+  bool spill(const GroupTable& table) {
+    for (auto const& group : table.getSlots()) {
+      if (group.count == 0)
+        continue;
+      std::FILE*& file = files[spillPartition(group.hash, level)];
+      if (file == nullptr && (file = tmpfile()) == nullptr)
+        return false;
+      if (fwrite(&group.hash, sizeof(group.hash), 1, file) != 1 ||
+          fwrite(&group.count, sizeof(group.count), 1, file) != 1 ||
+          fwrite(&group.value, sizeof(group.value), 1, file) != 1 ||
+          fwrite(&group.size, sizeof(group.size), 1, file) != 1 ||
+          fwrite(group.key, 1, group.size, file) != group.size)
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * Передает обработчику группы раздела. Ключ группы действителен только
+   * во время вызова.
+   *
+   * @return false при ошибке чтения.
+   */
+  bool load(const size_t partition,
+            const std::function<void(const Group&)>& consumer) {
+    std::FILE* file = files[partition];
+    if (file == nullptr)
+      return true;
+    if (fflush(file) != 0 || fseek(file, 0, SEEK_SET) != 0)
+      return false;
+
+    Group group;
+    std::string key;
+    while (fread(&group.hash, sizeof(group.hash), 1, file) == 1) {
+      if (fread(&group.count, sizeof(group.count), 1, file) != 1 ||
+          fread(&group.value, sizeof(group.value), 1, file) != 1 ||
+          fread(&group.size, sizeof(group.size), 1, file) != 1)
+        return false;
+      key.resize(group.size);
+      if (fread(&key[0], 1, group.size, file) != group.size)
+        return false;
+      group.key = key.data();
+      consumer(group);
+    }
+    return !ferror(file);
+  }
+
+ private:
+  const size_t level;
+  std::vector<std::FILE*> files;
+};
+
+/**
+ * Слияние групп одного раздела в пределах бюджета. Если таблица с ключами
+ * превышает бюджет, она сбрасывается на диск по разделам следующего уровня,
+ * которые затем сливаются по отдельности.
+ */
+class GroupMerge {
+ public:
+  GroupMerge(const Aggregate::Operation operation,
+             const size_t budget,
+             const size_t level)
+      : operation(operation),
+        budget(budget),
+        level(level),
+        table(operation),
+        keysMemory(0) {}
+
+  /**
+   * Добавляет частичный результат группы.
+   *
+   * @param copy Ключ действителен только во время вызова и копируется.
+   */
+  void add(Group group, const bool copy) throw(wkfw::WorkerExecuteException) {
+    if (copy) {
+      keys.push_back(std::string(group.key, group.size));
+      keysMemory += group.size + sizeof(std::string);
+      group.key = keys.back().data();
+    }
+    table.add(group);
+
+    // На последнем уровне разделы больше не делятся
+    if (table.memory() + keysMemory <= budget || level + 1 >= SPILL_LEVELS)
+      return;
+    if (!overflow)
+      overflow.reset(new SpillFiles(level + 1));
+    if (!overflow->spill(table))
+      throw wkfw::WorkerExecuteException("Cannot write aggregation to disk.");
+    table.clear();
+    keys.clear();
+    keysMemory = 0;
+  }
+
+  /**
+   * Дописывает итоговые строки групп раздела.
+   */
+  void finish(std::vector<std::pair<std::string, std::string>>& rows) throw(
+      wkfw::WorkerExecuteException) {
+    if (overflow) {
+      if (!overflow->spill(table))
+        throw wkfw::WorkerExecuteException("Cannot write aggregation to disk.");
+      table.clear();
+      keys.clear();
+      for (size_t partition = 0; partition < SPILL_PARTITIONS; partition++) {
+        GroupMerge merge(operation, budget, level + 1);
+        if (!overflow->load(partition, [&merge](const Group& group) {
+              merge.add(group, true);
+            }))
+          throw wkfw::WorkerExecuteException(
+              "Cannot read aggregation from disk.");
+        merge.finish(rows);
+      }
+      return;
+    }
+
+    for (auto const& group : table.getSlots()) {
+      if (group.count == 0)
+        continue;
+      rows.push_back(std::make_pair(
+          std::string(group.key, group.size),
+          operation == Aggregate::Operation::COUNT
+              ? std::to_string(group.count)
+              : formatNumber(group.value)));
+    }
+  }
+
+ private:
+  const Aggregate::Operation operation;
+  const size_t budget;
+  const size_t level;
+  GroupTable table;
+  std::deque<std::string> keys;
+  size_t keysMemory;
+  std::unique_ptr<SpillFiles> overflow;
+};
+
+const wkfw::WorkerResult Aggregate::execute(
+    const wkfw::WorkerResult& previous) const
+    throw(wkfw::WorkerExecuteException) {
+  const wkfw::Text& text = previous.getValue();
+  const wkfw::FieldIndex& fields = previous.getFields();
+
+  const size_t parts = countPartitions(text.size());
+  std::vector<GroupTable> tables(parts, GroupTable(operation));
+  std::vector<std::unique_ptr<SpillFiles>> spills(parts);
+  std::vector<char> failed(parts, false);
+
+  // При ограничении памяти исполнения таблицы не занимают больше половины
+  // свободного остатка, слияние - столько же
+  size_t budget = memoryBudget;
+  const std::shared_ptr<wkfw::MemoryBudget> execution = previous.getBudget();
+  if (execution)
+    budget = std::min(budget, execution->getAvailable() / 2);
+  const size_t tableBudget =
+      std::max(budget / parts, MIN_GROUP_TABLE_MEMORY);
+  const size_t mergeBudget = std::max(budget, MIN_GROUP_TABLE_MEMORY);
+
+  forEachPartition(text.size(), parts, [&](size_t part, size_t begin,
+                                           size_t end) {
+    GroupTable& table = tables[part];
+    for (size_t i = begin; i < end && !failed[part]; i++) {
+      if (fields.getCount(i) < keyField)
+        continue;
+      Group group{0, nullptr, 0, 1, 0};
+
+      if (operation != Operation::COUNT) {
+        wkfw::FieldSpan span = fields.getField(i, valueField);
+        char number[64];
+        const size_t size = std::min<size_t>(span.size(), sizeof(number) - 1);
+        memcpy(number, text[i].data + span.begin, size);
+        number[size] = '\0';
+        char* parsed;
+        group.value = std::strtod(number, &parsed);
+        if (parsed == number)
+          continue;
+      }
+
+      wkfw::FieldSpan key = fields.getField(i, keyField);
+      group.key = text[i].data + key.begin;
+      group.size = key.size();
+      group.hash = wkfw::hashBytes(group.key, group.size);
+      table.add(group);
+
+      // Таблица превысила свою долю бюджета - сбрасываем ее на диск
+      if (table.memory() > tableBudget) {
+        if (!spills[part])
+          spills[part].reset(new SpillFiles(0));
+        failed[part] = !spills[part]->spill(table);
+        table.clear();
+      }
+    }
+  });
+
+  for (size_t part = 0; part < parts; part++)
+    if (failed[part])
+      throw wkfw::WorkerExecuteException("Cannot write aggregation to disk.");
+
+  // Слияние частичных таблиц: по разделам, если что-то сброшено на диск
+  bool spilled = false;
+  for (auto const& spill : spills)
+    spilled = spilled || spill;
+  const size_t partitions = spilled ? SPILL_PARTITIONS : 1;
+
+  std::vector<std::pair<std::string, std::string>> rows;
+  for (size_t partition = 0; partition < partitions; partition++) {
+    GroupMerge merge(operation, mergeBudget, 0);
+    for (size_t part = 0; part < parts; part++) {
+      for (auto const& group : tables[part].getSlots())
+        if (group.count != 0 &&
+            (!spilled || spillPartition(group.hash, 0) == partition))
+          merge.add(group, false);
+      if (spills[part] &&
+          !spills[part]->load(partition, [&merge](const Group& group) {
+            merge.add(group, true);
+          }))
+        throw wkfw::WorkerExecuteException("Cannot read aggregation from disk.");
+    }
+    merge.finish(rows);
+  }
+
+  std::sort(rows.begin(), rows.end());
+  wkfw::TextBuilder list(previous.getArena());
+  list.reserve(rows.size());
+  for (auto const& row : rows)
+    list.add(row.first + '\t' + row.second);
+
+  return wkfw::WorkerResult(list.build());
+}
+
+std::string Aggregate::getFingerprint() const {
+  static const char* const OPERATIONS[] = {"count", "sum", "min", "max"};
+  std::string fingerprint = "aggregate " + std::to_string(keyField) + " " +
+                            OPERATIONS[(int)operation];
+  if (operation != Operation::COUNT)
+    fingerprint += " " + std::to_string(valueField);
+  return fingerprint;
+}
+
+/**
+ * Файл, отображенный в память только для чтения.
+ */
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& filename) throw(
+      wkfw::WorkerExecuteException)
+      : data(nullptr), size(0) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+      if (fd >= 0)
+        close(fd);
+      throw wkfw::WorkerExecuteException("Cannot read lines from file \"" +
+                                         filename + "\"");
+    }
+
+    size = info.st_size;
+    if (size > 0) {
+      void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      data = mapped == MAP_FAILED ? nullptr : (const char*)mapped;
+    }
+    close(fd);
+    if (size > 0 && data == nullptr)
+      throw wkfw::WorkerExecuteException("Cannot map file \"" + filename +
+                                         "\" to memory.");
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (data != nullptr)
+      munmap((void*)data, size);
+  }
+
+  const char* getData() const { return data; }
+  size_t getSize() const { return size; }
+
+ private:
+  const char* data;
+  size_t size;
+};
+
+/**
+ * Запись индекса соответствий: ключ и значение указывают в файл.
+ */
+struct JoinEntry {
+  uint64_t hash;
+  const char* key;
+  const char* value;
+  uint32_t keySize;
+  uint32_t valueSize;
+};
+
+const wkfw::WorkerResult Join::execute(const wkfw::WorkerResult& previous) const
+    throw(wkfw::WorkerExecuteException) {
+  const wkfw::Text& text = previous.getValue();
+  const MappedFile lookup(filename);
+  auto separator = [](char symbol) { return symbol == ' ' || symbol == '\t'; };
+
+  // Разбираем строки файла: первое поле - ключ, остаток строки - значение
+  std::vector<JoinEntry> entries;
+  const char* position = lookup.getData();
+  const char* end = position + lookup.getSize();
+  while (position < end) {
+    const char* lineEnd = (const char*)memchr(position, '\n', end - position);
+    if (lineEnd == nullptr)
+      lineEnd = end;
+
+    const char* key = position;
+    while (key < lineEnd && separator(*key))
+      key++;
+    const char* keyEnd = key;
+    while (keyEnd < lineEnd && !separator(*keyEnd))
+      keyEnd++;
+    const char* value = keyEnd;
+    while (value < lineEnd && separator(*value))
+      value++;
+
+    if (key < keyEnd)
+      entries.push_back(JoinEntry{wkfw::hashBytes(key, keyEnd - key), key,
+                                  value, (uint32_t)(keyEnd - key),
+                                  (uint32_t)(lineEnd - value)});
+    position = lineEnd + 1;
+  }
+
+  // Открытая адресация над номерами записей, 0 - пустая ячейка
+  size_t capacity = 16;
+  while (capacity < entries.size() * 2)
+    capacity <<= 1;
+  const size_t mask = capacity - 1;
+  std::vector<uint32_t> table(capacity, 0);
+  auto find = [&](uint64_t hash, const char* key, size_t size) {
+    size_t slot = hash & mask;
+    while (table[slot] != 0) {
+      const JoinEntry& entry = entries[table[slot] - 1];
+      if (entry.hash == hash && entry.keySize == size &&
+          memcmp(entry.key, key, size) == 0)
+        break;
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  };
+  for (size_t i = 0; i < entries.size(); i++) {
+    size_t slot = find(entries[i].hash, entries[i].key, entries[i].keySize);
+    if (table[slot] == 0)
+      table[slot] = i + 1;
+  }
+
+  // Части текста сопоставляются параллельно: номер строки и номер
+  // записи таблицы для каждого совпадения
+  typedef std::pair<size_t, size_t> Match;
+  const wkfw::FieldIndex& fields = previous.getFields();
+  const size_t parts = countPartitions(text.size());
+  std::vector<std::vector<Match>> matches(parts);
+  forEachPartition(text.size(), parts, [&](size_t part, size_t begin,
+                                           size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      if (fields.getCount(i) < field)
+        continue;
+      wkfw::FieldSpan span = fields.getField(i, field);
+      const char* key = text[i].data + span.begin;
+      size_t slot = find(wkfw::hashBytes(key, span.size()), key, span.size());
+      if (table[slot] != 0)
+        matches[part].push_back(Match(i, table[slot] - 1));
+    }
+  });
+
+  // Строки результата собираются по порядку в один столбец
+  wkfw::TextBuilder list(previous.getArena());
+  for (auto const& part : matches) {
+    for (auto const& match : part) {
+      const wkfw::Line line = text[match.first];
+      const JoinEntry& entry = entries[match.second];
+      char* joined = list.addLine(line.size + 1 + entry.valueSize);
+      memcpy(joined, line.data, line.size);
+      joined[line.size] = '\t';
+      memcpy(joined + line.size + 1, entry.value, entry.valueSize);
+    }
+  }
+
+  return wkfw::WorkerResult(list.build());
+}
+
+std::string Join::getFingerprint() const {
+  const std::string description = describeFile(filename);
+  return description == ""
+             ? ""
+             : "join " + std::to_string(field) + " " + description;
+}
+
+/**
+ * Находит непересекающиеся вхождения подстроки в строке.
+ *
+ * @param found Позиции вхождений, прежнее содержимое удаляется.
+ *
+ * @return Длина строки после замены вхождений на substitution.
+ */
+static size_t findAll(const wkfw::Line& line,
+                      const std::string& pattern,
+                      const std::string& substitution,
+                      std::vector<size_t>& found) {
+  found.clear();
+  const size_t step = std::max<size_t>(pattern.size(), 1);
+  for (size_t index = line.find(pattern); index != std::string::npos;
+       index = line.find(pattern, index + step))
+    found.push_back(index);
+  return line.size + found.size() * substitution.size() -
+         found.size() * pattern.size();
+}
+
+/**
+ * Заменяет подстроки в строке.
+ *
+ * @param line Исходная строка
+ * @param found Вхождения паттерна (см. findAll)
+ * @param pattern Паттерн для замены
+ * @param substitution Замена для паттерна
+ * @param output Место для строки с примененными заменами.
+ */
+static void replace(const wkfw::Line& line,
+                    const std::vector<size_t>& found,
+                    const std::string& pattern,
+                    const std::string& substitution,
+                    char* output) {
+  size_t copied = 0;
+  for (auto index : found) {
+    memcpy(output, line.data + copied, index - copied);
+    output += index - copied;
+    memcpy(output, substitution.data(), substitution.size());
+    output += substitution.size();
+    copied = index + pattern.size();
+  }
+  memcpy(output, line.data + copied, line.size - copied);
+}
+
+void Replace::processBatch(const wkfw::WorkerResult& previous,
+                           const size_t begin,
+                           const size_t end,
+                           wkfw::TextBuilder& output) const {
+  const wkfw::Text& text = previous.getValue();
+  std::vector<size_t> found;
+
+  // Пока вхождений нет, текст остается выборкой из входа. Первая же
+  // замена переносит строки в новый столбец
+  for (size_t i = begin; i < end; i++) {
+    const wkfw::Line line = text[i];
+    const size_t size = findAll(line, pattern, substitution, found);
+    if (found.empty()) {
+      output.keep(text, i);
+      continue;
+    }
+    replace(line, found, pattern, substitution, output.addLine(size));
+  }
+}
+
+std::string Replace::getFingerprint() const {
+  return "replace " + std::to_string(pattern.size()) + " " + pattern +
+         substitution;
+}
+
+const wkfw::WorkerResult Uniq::execute(const wkfw::WorkerResult& previous) const
+    throw(wkfw::WorkerExecuteException) {
+  const wkfw::Text& text = previous.getValue();
+  wkfw::TextBuilder list(previous.getArena());
+
+  // Ячейка: хэш строки и номер строки + 1 (0 - пустая ячейка)
+  struct Slot {
+    uint64_t hash;
+    size_t line;
+  };
+  size_t capacity = 16;
+  while (capacity < text.size() * 2)
+    capacity <<= 1;
+  std::vector<Slot> table(capacity, Slot{0, 0});
+  const size_t mask = capacity - 1;
+
+  for (size_t i = 0; i < text.size(); i++) {
+    const wkfw::Line line = text[i];
+    const uint64_t hash = wkfw::hashBytes(line.data, line.size);
+    size_t slot = hash & mask;
+    while (table[slot].line != 0 &&
+           (table[slot].hash != hash || text[table[slot].line - 1] != line))
+      slot = (slot + 1) & mask;
+
+    if (table[slot].line == 0) {
+      table[slot] = Slot{hash, i + 1};
+      list.keep(text, i);
+    }
+  }
+
+  return wkfw::WorkerResult(list.build());
+}
+
+std::string Uniq::getFingerprint() const {
+  return "uniq";
+}
+
+const wkfw::WorkerResult ApproxUniq::execute(
+    const wkfw::WorkerResult& previous) const
+    throw(wkfw::WorkerExecuteException) {
+  const wkfw::Text& text = previous.getValue();
+  wkfw::TextBuilder list(previous.getArena());
+
+  // Около 9.6 бит на строку и 7 хэш-функций дают 1% ложных срабатываний
+  const size_t HASHES = 7;
+  const size_t count = std::max<size_t>(expected ? expected : text.size(), 1);
+  size_t bits = 64;
+  while (bits < count * 10)
+    bits <<= 1;
+  std::vector<uint64_t> filter(bits / 64, 0);
+  const size_t mask = bits - 1;
+
+  for (size_t line = 0; line < text.size(); line++) {
+    // Двойное хэширование: i-я функция - h1 + i * h2
+    const uint64_t hash = wkfw::hashBytes(text[line].data, text[line].size);
+    const uint64_t step = wkfw::mixBits(hash) | 1;
+    bool seen = true;
+    for (size_t i = 0; i < HASHES; i++) {
+      const size_t bit = (hash + i * step) & mask;
+      const uint64_t flag = 1ULL << (bit & 63);
+      seen = seen && (filter[bit >> 6] & flag);
+      filter[bit >> 6] |= flag;
+    }
+    if (!seen)
+      list.keep(text, line);
+  }
+
+  return wkfw::WorkerResult(list.build());
+}
 
-  return wkfw::WorkerResult(list);
+std::string ApproxUniq::getFingerprint() const {
+  return "approxuniq " + std::to_string(expected);
 }
 
 const wkfw::WorkerResult Dump::execute(const wkfw::WorkerResult& previous) const
     throw(wkfw::WorkerExecuteException) {
   WriteFile::execute(previous);
 
-  return wkfw::WorkerResult(previous.getValue());
+  return previous;
 }
 
 }  // namespace workers
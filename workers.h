@@ -9,7 +9,11 @@
 #ifndef WORKERS_H_
 #define WORKERS_H_
 
+#include <cstdint>
+#include <cstdio>
+#include <functional>
 #include <string>
+#include <vector>
 
 #include "worker.h"
 
@@ -29,27 +33,170 @@ const wkfw::Worker* constructWorker(const size_t ident,
                                     const std::vector<std::string>& args);
 
 /**
- * Считывание текстового файла в память, целиком.
+ * Имя файла, означающее стандартный ввод при чтении
+ * и стандартный вывод при записи.
+ */
+const std::string STANDARD_STREAM = "-";
+
+/**
+ * Количество строк в одной порции обработки построчного обработчика
+ * (см. LineWorker::processBatch).
+ */
+const size_t BATCH_LINES = 4096;
+
+/**
+ * Обработчик, обрабатывающий каждую строку независимо от остальных.
+ * Такие обработчики можно применять к любой части текста по отдельности,
+ * например только к дописанному в конец файла.
+ *
+ * Text -> Text
+ */
+class LineWorker : public wkfw::Worker {
+ public:
+  LineWorker(const size_t ident)
+      : wkfw::Worker(ident,
+                     wkfw::WorkerResult::ResultType::TEXT,
+                     wkfw::WorkerResult::ResultType::TEXT) {}
+
+  /**
+   * Обрабатывает текст порциями по BATCH_LINES строк, результаты порций
+   * добавляются в один строитель.
+   */
+  const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
+      throw(wkfw::WorkerExecuteException) override;
+
+  /**
+   * Обрабатывает порцию строк текста: виртуальный вызов приходится
+   * на порцию, а не на строку, и цикл по строкам остается внутри
+   * обработчика.
+   *
+   * @param previous Результат предыдущего блока.
+   * @param begin Первая строка порции.
+   * @param end Строка после последней строки порции.
+   * @param output Строитель результата, строки порции добавляются в него
+   * в том же порядке.
+   */
+  virtual void processBatch(const wkfw::WorkerResult& previous,
+                            const size_t begin,
+                            const size_t end,
+                            wkfw::TextBuilder& output) const = 0;
+
+  /**
+   * Лениво обрабатывает каждую часть входа отдельно (execute),
+   * части без строк не передаются дальше.
+   */
+  std::unique_ptr<wkfw::Cursor> open(std::unique_ptr<wkfw::Cursor> input,
+                                     std::shared_ptr<wkfw::MemoryBudget> budget)
+      const throw(wkfw::WorkerExecuteException) override;
+};
+
+/**
+ * Применяет построчные обработчики к тексту по очереди.
+ *
+ * @param arena Арена для новых строк или nullptr.
+ */
+wkfw::Text applyLineWorkers(const std::vector<const LineWorker*>& stages,
+                            const wkfw::Text& text,
+                            std::shared_ptr<wkfw::Arena> arena) throw(
+    wkfw::WorkerExecuteException);
+
+/**
+ * Считывание текстовых файлов в память, целиком.
+ * Принимает несколько имен файлов и шаблонов (glob), несколько файлов
+ * читаются параллельно. STANDARD_STREAM - стандартный ввод.
  *
  * None -> Text
  */
 class ReadFile : public wkfw::Worker {
  public:
+  /**
+   * Объединение строк нескольких файлов.
+   */
+  enum class Mode {
+    CONCAT,      // Файлы друг за другом в порядке перечисления
+    INTERLEAVE,  // Блоки строк файлов в порядке готовности
+    MERGE        // Слияние уже отсортированных файлов
+  };
+
   ReadFile(const size_t ident, const std::string& filename)
+      : ReadFile(ident, std::vector<std::string>(1, filename)) {}
+
+  /**
+   * @param patterns Имена файлов и шаблоны имен.
+   */
+  ReadFile(const size_t ident,
+           const std::vector<std::string>& patterns,
+           const Mode mode = Mode::CONCAT)
       : wkfw::Worker(ident,
                      wkfw::WorkerResult::ResultType::TEXT,
                      wkfw::WorkerResult::ResultType::NONE),
-        filename(filename) {}
+        patterns(patterns),
+        mode(mode) {}
 
   const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
       throw(wkfw::WorkerExecuteException) override;
 
+  /**
+   * Считывает только полные строки (завершенные переносом строки),
+   * начиная с заданного смещения. Только для одного файла.
+   *
+   * @param offset Смещение в байтах от начала файла.
+   * @param end Смещение после последней считанной строки.
+   */
+  const wkfw::WorkerResult readFrom(const uint64_t offset, uint64_t& end) const
+      throw(wkfw::WorkerExecuteException);
+
+  /**
+   * Потоковое чтение: строки передаются обработчику по одной,
+   * и чтение прекращается, как только он вернет false.
+   * Несколько файлов читаются друг за другом.
+   *
+   * @param consumer Обработчик строки, может изменять ее.
+   * @param backward Читать строки с конца файла блоками.
+   */
+  void scan(const std::function<bool(std::string&)>& consumer,
+            const bool backward = false) const
+      throw(wkfw::WorkerExecuteException);
+
+  /**
+   * Лениво читает файлы друг за другом блоками, каждая часть - полные
+   * строки блока. Чтение в порядке готовности и слияние исполняются целиком.
+   */
+  std::unique_ptr<wkfw::Cursor> open(std::unique_ptr<wkfw::Cursor> input,
+                                     std::shared_ptr<wkfw::MemoryBudget> budget)
+      const throw(wkfw::WorkerExecuteException) override;
+
+  /**
+   * Отпечаток включает размеры и время изменения файлов.
+   * Результат чтения в порядке готовности не кэшируется.
+   */
+  std::string getFingerprint() const override;
+
+  /**
+   * @return Имена читаемых файлов с раскрытыми шаблонами.
+   */
+  std::vector<std::string> getFilenames() const
+      throw(wkfw::WorkerExecuteException);
+
+  /**
+   * @return true, если читается ровно один файл без шаблона.
+   */
+  bool isSingleFile() const;
+
+  /**
+   * @return Имя первого файла.
+   */
+  const std::string& getFilename() const { return patterns.front(); }
+
+  Mode getMode() const { return mode; }
+
  private:
-  const std::string filename;
+  const std::vector<std::string> patterns;
+  const Mode mode;
 };
 
 /**
- * Запись текста в файл.
+ * Запись текста в файл, STANDARD_STREAM - в стандартный вывод.
  *
  * Text -> None
  */
@@ -64,6 +211,22 @@ class WriteFile : public wkfw::Worker {
   virtual const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous)
       const throw(wkfw::WorkerExecuteException) override;
 
+  /**
+   * Дописывает текст в конец файла.
+   */
+  void append(const wkfw::WorkerResult& previous) const
+      throw(wkfw::WorkerExecuteException);
+
+  /**
+   * Лениво записывает части входа по мере их вычисления в один раз
+   * открытый файл. Файл создается, даже если строк нет.
+   */
+  std::unique_ptr<wkfw::Cursor> open(std::unique_ptr<wkfw::Cursor> input,
+                                     std::shared_ptr<wkfw::MemoryBudget> budget)
+      const throw(wkfw::WorkerExecuteException) override;
+
+  const std::string& getFilename() const { return filename; }
+
  protected:
   WriteFile(const size_t ident,
             const std::string& filename,
@@ -75,22 +238,73 @@ class WriteFile : public wkfw::Worker {
   const std::string filename;
 };
 
+/**
+ * Запись текста в несколько файлов (частей) < prefix >.0, < prefix >.1, ...
+ * Каждая часть накапливается в своем буфере и записывается своим потоком.
+ *
+ * Text -> None
+ */
+class Split : public wkfw::Worker {
+ public:
+  /**
+   * Распределение строк по частям.
+   */
+  enum class Mode {
+    HASH,  // По хешу строки или поля, равные ключи попадают в одну часть
+    SIZE   // Подряд идущими кусками примерно равного размера в байтах
+  };
+
+  /**
+   * @param shards Количество частей.
+   * @param field Номер поля-ключа для HASH, 0 - вся строка.
+   */
+  Split(const size_t ident,
+        const Mode mode,
+        const size_t shards,
+        const std::string& prefix,
+        const size_t field = 0)
+      : wkfw::Worker(ident,
+                     wkfw::WorkerResult::ResultType::NONE,
+                     wkfw::WorkerResult::ResultType::TEXT),
+        mode(mode),
+        shards(shards),
+        prefix(prefix),
+        field(field) {}
+
+  const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
+      throw(wkfw::WorkerExecuteException) override;
+
+  /**
+   * @return Имя файла части.
+   */
+  std::string getShardFilename(const size_t shard) const {
+    return prefix + "." + std::to_string(shard);
+  }
+
+ private:
+  const Mode mode;
+  const size_t shards;
+  const std::string prefix;
+  const size_t field;
+};
+
 /**
  * Выбор из входного текста строк, разделенных символами переноса строки,
  * содержащих заданное слово.
  *
  * Text -> Text
  */
-class Grep : public wkfw::Worker {
+class Grep : public LineWorker {
  public:
   Grep(const size_t ident, const std::string& pattern)
-      : Worker(ident,
-               wkfw::WorkerResult::ResultType::TEXT,
-               wkfw::WorkerResult::ResultType::TEXT),
-        pattern(pattern) {}
+      : LineWorker(ident), pattern(pattern) {}
 
-  const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
-      throw(wkfw::WorkerExecuteException) override;
+  void processBatch(const wkfw::WorkerResult& previous,
+                    const size_t begin,
+                    const size_t end,
+                    wkfw::TextBuilder& output) const override;
+
+  std::string getFingerprint() const override;
 
  private:
   const std::string pattern;
@@ -98,18 +312,350 @@ class Grep : public wkfw::Worker {
 
 /**
  * Лексикогорафическая сортировка входного набора строк.
+ * Может схлопывать одинаковые строки прямо при формировании результата.
  *
  * Text -> Text
  */
 class Sort : public wkfw::Worker {
  public:
-  Sort(const size_t ident)
+  /**
+   * Обработка одинаковых строк.
+   */
+  enum class Collapse {
+    NONE,    // Оставлять все строки
+    UNIQUE,  // Оставлять одну строку
+    COUNT    // Оставлять одну строку вида "<количество>\t<строка>"
+  };
+
+  /**
+   * Порядок ключей сортировки.
+   */
+  enum class Order {
+    TEXT,     // Лексикографический
+    NUMERIC,  // По числу в начале ключа
+    HUMAN,    // По размеру с суффиксом: 2K < 1M
+    VERSION   // По номерам версий: 1.9 < 1.10
+  };
+
+  /**
+   * @param field Поле, по которому сортируются строки (с 1),
+   * или 0 - сортировка по строке целиком.
+   */
+  Sort(const size_t ident,
+       const Collapse collapse = Collapse::NONE,
+       const size_t field = 0,
+       const Order order = Order::TEXT)
       : wkfw::Worker(ident,
                      wkfw::WorkerResult::ResultType::TEXT,
-                     wkfw::WorkerResult::ResultType::TEXT) {}
+                     wkfw::WorkerResult::ResultType::TEXT),
+        collapse(collapse),
+        field(field),
+        order(order) {}
 
   const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
       throw(wkfw::WorkerExecuteException) override;
+
+  std::string getFingerprint() const override;
+
+  /**
+   * Слияние двух результатов этой сортировки в один,
+   * как если бы сортировался весь текст сразу.
+   */
+  wkfw::Text merge(const wkfw::Text& first, const wkfw::Text& second) const;
+
+  /**
+   * Записывает результат этой сортировки во временный файл - часть
+   * внешней сортировки. Файл удаляется после закрытия.
+   */
+  std::FILE* spill(const wkfw::Text& sorted) const
+      throw(wkfw::WorkerExecuteException);
+
+  /**
+   * Слияние частей внешней сортировки (см. spill), как если бы сортировался
+   * весь текст сразу. Строки результата передаются обработчику по одной,
+   * и слияние прекращается, как только он вернет false.
+   */
+  void mergeRuns(const std::vector<std::FILE*>& runs,
+                 const std::function<bool(std::string&)>& consumer) const
+      throw(wkfw::WorkerExecuteException);
+
+  Collapse getCollapse() const { return collapse; }
+
+  size_t getField() const { return field; }
+
+  Order getOrder() const { return order; }
+
+ private:
+  const Collapse collapse;
+  const size_t field;
+  const Order order;
+
+  /**
+   * Упорядочивает строки текста без копирования.
+   *
+   * @return Номера строк текста в порядке сортировки.
+   */
+  std::vector<size_t> arrange(const wkfw::WorkerResult& previous) const;
+
+  /**
+   * Сравнивает строки в порядке этой сортировки.
+   *
+   * @param skipA Длина префикса первой строки, не участвующего в сравнении.
+   * @param skipB Длина префикса второй строки, не участвующего в сравнении.
+   */
+  int compare(const wkfw::Line& a,
+              const size_t skipA,
+              const wkfw::Line& b,
+              const size_t skipB) const;
+};
+
+/**
+ * Первые <количество> строк в лексикографическом порядке, то есть начало
+ * результата sort. Не сортирует весь текст: каждая часть входа параллельно
+ * отбирает кандидатов в ограниченную кучу, после чего кандидаты сливаются.
+ *
+ * Text -> Text
+ */
+class Top : public wkfw::Worker {
+ public:
+  Top(const size_t ident, const size_t count)
+      : wkfw::Worker(ident,
+                     wkfw::WorkerResult::ResultType::TEXT,
+                     wkfw::WorkerResult::ResultType::TEXT),
+        count(count) {}
+
+  const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
+      throw(wkfw::WorkerExecuteException) override;
+
+  std::string getFingerprint() const override;
+
+ private:
+  const size_t count;
+};
+
+/**
+ * Первые <количество> строк текста.
+ *
+ * Text -> Text
+ */
+class Head : public wkfw::Worker {
+ public:
+  Head(const size_t ident, const size_t count)
+      : wkfw::Worker(ident,
+                     wkfw::WorkerResult::ResultType::TEXT,
+                     wkfw::WorkerResult::ResultType::TEXT),
+        count(count) {}
+
+  const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
+      throw(wkfw::WorkerExecuteException) override;
+
+  /**
+   * Запрашивает части входа, только пока не набрано нужное количество строк.
+   */
+  std::unique_ptr<wkfw::Cursor> open(std::unique_ptr<wkfw::Cursor> input,
+                                     std::shared_ptr<wkfw::MemoryBudget> budget)
+      const throw(wkfw::WorkerExecuteException) override;
+
+  std::string getFingerprint() const override;
+
+  size_t getCount() const { return count; }
+
+ private:
+  const size_t count;
+};
+
+/**
+ * Последние <количество> строк текста.
+ *
+ * Text -> Text
+ */
+class Tail : public wkfw::Worker {
+ public:
+  Tail(const size_t ident, const size_t count)
+      : wkfw::Worker(ident,
+                     wkfw::WorkerResult::ResultType::TEXT,
+                     wkfw::WorkerResult::ResultType::TEXT),
+        count(count) {}
+
+  const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
+      throw(wkfw::WorkerExecuteException) override;
+
+  std::string getFingerprint() const override;
+
+  size_t getCount() const { return count; }
+
+ private:
+  const size_t count;
+};
+
+/**
+ * Слитые чтение файла, построчные обработчики и head/tail.
+ * Файл читается потоково (для tail - с конца), и чтение прекращается,
+ * как только набрано нужное количество строк. Создается при оптимизации
+ * графа исполнения, в схеме не используется.
+ *
+ * None -> Text
+ */
+class LimitedRead : public wkfw::Worker {
+ public:
+  /**
+   * @param reader Чтение файла.
+   * @param stages Построчные обработчики в порядке применения.
+   * @param count Количество строк результата.
+   * @param backward Последние строки вместо первых.
+   */
+  LimitedRead(const size_t ident,
+              const ReadFile* reader,
+              const std::vector<const LineWorker*>& stages,
+              const size_t count,
+              const bool backward)
+      : wkfw::Worker(ident,
+                     wkfw::WorkerResult::ResultType::TEXT,
+                     wkfw::WorkerResult::ResultType::NONE),
+        reader(reader),
+        stages(stages),
+        count(count),
+        backward(backward) {}
+
+  const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
+      throw(wkfw::WorkerExecuteException) override;
+
+  std::string getFingerprint() const override;
+
+ private:
+  const ReadFile* reader;
+  const std::vector<const LineWorker*> stages;
+  const size_t count;
+  const bool backward;
+};
+
+/**
+ * Выбор полей строк. Выбранные поля разделяются табуляцией,
+ * отсутствующие в строке поля остаются пустыми.
+ *
+ * Text -> Text
+ */
+class Cut : public LineWorker {
+ public:
+  /**
+   * @param fields Номера выбираемых полей (с 1) в порядке вывода.
+   */
+  Cut(const size_t ident, const std::vector<size_t>& fields)
+      : LineWorker(ident), fields(fields) {}
+
+  void processBatch(const wkfw::WorkerResult& previous,
+                    const size_t begin,
+                    const size_t end,
+                    wkfw::TextBuilder& output) const override;
+
+  std::string getFingerprint() const override;
+
+ private:
+  const std::vector<size_t> fields;
+};
+
+/**
+ * Выбор строк, заданное поле которых содержит слово.
+ *
+ * Text -> Text
+ */
+class FieldGrep : public LineWorker {
+ public:
+  FieldGrep(const size_t ident, const size_t field, const std::string& pattern)
+      : LineWorker(ident), field(field), pattern(pattern) {}
+
+  void processBatch(const wkfw::WorkerResult& previous,
+                    const size_t begin,
+                    const size_t end,
+                    wkfw::TextBuilder& output) const override;
+
+  std::string getFingerprint() const override;
+
+ private:
+  const size_t field;
+  const std::string pattern;
+
+  bool matches(const wkfw::Line& line, const wkfw::FieldSpan& span) const;
+};
+
+/**
+ * Группировка строк по значению поля с вычислением количества строк,
+ * суммы, минимума или максимума числового поля в каждой группе.
+ * Результат - строки "<ключ>\t<значение>" в порядке ключей.
+ * Строки без поля ключа или без числа в поле значения пропускаются.
+ *
+ * Части текста агрегируются параллельно в собственные хэш-таблицы,
+ * которые затем сливаются. Таблица, превысившая свою долю бюджета памяти,
+ * сбрасывается на диск по разделам хэшей, и разделы сливаются по одному.
+ *
+ * Text -> Text
+ */
+class Aggregate : public wkfw::Worker {
+ public:
+  enum class Operation { COUNT, SUM, MIN, MAX };
+
+  /**
+   * @param keyField Поле ключа (с 1).
+   * @param valueField Поле значения (с 1), для COUNT не используется.
+   * @param memoryBudget Бюджет памяти хэш-таблиц в байтах.
+   */
+  Aggregate(const size_t ident,
+            const size_t keyField,
+            const Operation operation,
+            const size_t valueField,
+            const size_t memoryBudget = 256 * 1024 * 1024)
+      : wkfw::Worker(ident,
+                     wkfw::WorkerResult::ResultType::TEXT,
+                     wkfw::WorkerResult::ResultType::TEXT),
+        keyField(keyField),
+        operation(operation),
+        valueField(valueField),
+        memoryBudget(memoryBudget) {}
+
+  const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
+      throw(wkfw::WorkerExecuteException) override;
+
+  std::string getFingerprint() const override;
+
+ private:
+  const size_t keyField;
+  const Operation operation;
+  const size_t valueField;
+  const size_t memoryBudget;
+};
+
+/**
+ * Внутреннее соединение с файлом соответствий. Каждая строка файла -
+ * ключ (первое поле) и значение (остаток строки). Строка текста, поле которой
+ * совпадает с ключом, дополняется значением: "<строка>\t<значение>",
+ * остальные строки отбрасываются. При повторе ключа в файле используется
+ * первое значение.
+ *
+ * Файл отображается в память, индекс ключей указывает прямо в него;
+ * части текста сопоставляются параллельно.
+ *
+ * Text -> Text
+ */
+class Join : public wkfw::Worker {
+ public:
+  Join(const size_t ident, const std::string& filename, const size_t field)
+      : wkfw::Worker(ident,
+                     wkfw::WorkerResult::ResultType::TEXT,
+                     wkfw::WorkerResult::ResultType::TEXT),
+        filename(filename),
+        field(field) {}
+
+  const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
+      throw(wkfw::WorkerExecuteException) override;
+
+  /**
+   * Отпечаток включает размер и время изменения файла соответствий.
+   */
+  std::string getFingerprint() const override;
+
+ private:
+  const std::string filename;
+  const size_t field;
 };
 
 /**
@@ -117,23 +663,71 @@ class Sort : public wkfw::Worker {
  *
  * Text -> Text
  */
-class Replace : public wkfw::Worker {
+class Replace : public LineWorker {
  public:
   Replace(const size_t ident,
           const std::string& pattern,
           const std::string& substitution)
+      : LineWorker(ident), pattern(pattern), substitution(substitution) {}
+
+  void processBatch(const wkfw::WorkerResult& previous,
+                    const size_t begin,
+                    const size_t end,
+                    wkfw::TextBuilder& output) const override;
+
+  std::string getFingerprint() const override;
+
+ private:
+  const std::string pattern;
+  const std::string substitution;
+};
+
+/**
+ * Удаление повторяющихся строк за один проход с сохранением порядка
+ * первых вхождений. Использует хэш-таблицу с открытой адресацией
+ * над номерами строк входного текста.
+ *
+ * Text -> Text
+ */
+class Uniq : public wkfw::Worker {
+ public:
+  Uniq(const size_t ident)
+      : wkfw::Worker(ident,
+                     wkfw::WorkerResult::ResultType::TEXT,
+                     wkfw::WorkerResult::ResultType::TEXT) {}
+
+  const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
+      throw(wkfw::WorkerExecuteException) override;
+
+  std::string getFingerprint() const override;
+};
+
+/**
+ * Приближенное удаление повторяющихся строк с помощью фильтра Блума.
+ * Память ограничена размером фильтра; с вероятностью около 1% уникальная
+ * строка может быть ошибочно принята за повтор и отброшена.
+ *
+ * Text -> Text
+ */
+class ApproxUniq : public wkfw::Worker {
+ public:
+  /**
+   * @param expected Ожидаемое количество различных строк, по нему
+   * выбирается размер фильтра. Если 0 - количество строк входного текста.
+   */
+  ApproxUniq(const size_t ident, const size_t expected)
       : wkfw::Worker(ident,
                      wkfw::WorkerResult::ResultType::TEXT,
                      wkfw::WorkerResult::ResultType::TEXT),
-        pattern(pattern),
-        substitution(substitution) {}
+        expected(expected) {}
 
   const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
       throw(wkfw::WorkerExecuteException) override;
 
+  std::string getFingerprint() const override;
+
  private:
-  const std::string pattern;
-  const std::string substitution;
+  const size_t expected;
 };
 
 /**
@@ -149,6 +743,16 @@ class Dump : public WriteFile {
   const wkfw::WorkerResult execute(const wkfw::WorkerResult& previous) const
       throw(wkfw::WorkerExecuteException) override;
 
+  /**
+   * Сохраняется весь пришедший текст, даже если следующим блокам
+   * нужна только его часть, поэтому dump исполняется целиком.
+   */
+  std::unique_ptr<wkfw::Cursor> open(std::unique_ptr<wkfw::Cursor> input,
+                                     std::shared_ptr<wkfw::MemoryBudget> budget)
+      const throw(wkfw::WorkerExecuteException) override {
+    return wkfw::Worker::open(std::move(input), budget);
+  }
+
  private:
   const std::string filename;
 };
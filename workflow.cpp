@@ -6,7 +6,11 @@
 //  Copyright © 2017 Кирилл. All rights reserved.
 //
 
+#include <sys/stat.h>
+
 #include "workflow.h"
+#include "incremental.h"
+#include "streaming.h"
 #include "workers.h"
 
 namespace wkfw {
@@ -14,35 +18,279 @@ namespace wkfw {
 Workflow::Workflow(std::istream& stream,
                    const std::string& ifname,
                    const std::string& ofname) throw(InvalidWorkflowException)
-    : parser(WorkflowParser(stream)), ifname(ifname), ofname(ofname) {}
+    : parser(std::make_shared<WorkflowParser>(stream)),
+      ofname(ofname),
+      reader(new workers::ReadFile(0, ifname)),
+      writer(0, ofname) {
+  buildGraph();
+}
 
-void Workflow::execute() throw(WorkerExecuteException) {
-  WorkerResult lastResult;
-  Worker const* worker = parser.nextInstruction();
+Workflow::Workflow(std::shared_ptr<const WorkflowParser> parser,
+                   const std::string& ifname,
+                   const std::string& ofname)
+    : parser(parser),
+      ofname(ofname),
+      reader(new workers::ReadFile(0, ifname)),
+      writer(0, ofname) {
+  buildGraph();
+}
 
-  if (worker == nullptr)
-    return;
+/**
+ * Упрощает граф исполнения: sort -> head заменяется на top, а
+ * readfile -> [построчные обработчики] -> head/tail - на потоковое чтение,
+ * прекращающееся после нужного количества строк.
+ */
+static ExecutionGraph optimizeGraph(const ExecutionGraph& graph) {
+  // Узлы, поглощенные заменой, и замены узлов вместе с их входами
+  std::vector<bool> absorbed(graph.size(), false);
+  std::map<size_t, std::shared_ptr<const Worker>> replaced;
+  std::map<size_t, std::vector<size_t>> replacedInputs;
+  std::vector<size_t> readers;
+
+  for (size_t node = 0; node < graph.size(); node++) {
+    auto head = dynamic_cast<const workers::Head*>(graph.getWorker(node));
+    auto tail = dynamic_cast<const workers::Tail*>(graph.getWorker(node));
+    if ((head == nullptr && tail == nullptr) ||
+        graph.getInputs(node).size() != 1)
+      continue;
+    const size_t ident = graph.getWorker(node)->getId();
+    const size_t count = head != nullptr ? head->getCount() : tail->getCount();
+
+    // Поднимаемся по цепочке построчных обработчиков без ветвлений
+    std::vector<const workers::LineWorker*> stages;
+    std::vector<size_t> path;
+    size_t current = graph.getInputs(node).front();
+    while (graph.getOutputs(current).size() == 1 &&
+           graph.getInputs(current).size() == 1) {
+      auto stage =
+          dynamic_cast<const workers::LineWorker*>(graph.getWorker(current));
+      if (stage == nullptr)
+        break;
+      stages.insert(stages.begin(), stage);
+      path.push_back(current);
+      current = graph.getInputs(current).front();
+    }
+
+    auto reader =
+        dynamic_cast<const workers::ReadFile*>(graph.getWorker(current));
+    auto sort = dynamic_cast<const workers::Sort*>(graph.getWorker(current));
+    if (reader != nullptr && graph.getInputs(current).empty() &&
+        reader->getMode() == workers::ReadFile::Mode::CONCAT) {
+      for (auto stage : path)
+        absorbed[stage] = true;
+      replaced[node] = std::make_shared<workers::LimitedRead>(
+          ident, reader, stages, count, tail != nullptr);
+      replacedInputs[node] = std::vector<size_t>();
+      readers.push_back(current);
+    } else if (head != nullptr && path.empty() && sort != nullptr &&
+               sort->getCollapse() == workers::Sort::Collapse::NONE &&
+               sort->getField() == 0 &&
+               sort->getOrder() == workers::Sort::Order::TEXT &&
+               graph.getOutputs(current).size() == 1) {
+      absorbed[current] = true;
+      replaced[node] = std::make_shared<workers::Top>(ident, count);
+      replacedInputs[node] = graph.getInputs(current);
+    }
+  }
+
+  // Чтение файла больше не нужно, если все его потребители заменены
+  for (auto reader : readers) {
+    bool unused = true;
+    for (auto output : graph.getOutputs(reader))
+      unused = unused && (absorbed[output] || (replaced.count(output) &&
+                                               replacedInputs[output].empty()));
+    absorbed[reader] = unused;
+  }
+
+  ExecutionGraph optimized;
+  std::vector<size_t> positions(graph.size());
+  for (size_t node = 0; node < graph.size(); node++) {
+    if (absorbed[node])
+      continue;
+
+    auto replacement = replaced.find(node);
+    std::vector<size_t> inputs;
+    for (auto input : replacement != replaced.end() ? replacedInputs[node]
+                                                    : graph.getInputs(node))
+      inputs.push_back(positions[input]);
+
+    if (replacement != replaced.end())
+      positions[node] = optimized.addNode(replacement->second, inputs);
+    else if (graph.getOwnedWorker(node))
+      positions[node] = optimized.addNode(graph.getOwnedWorker(node), inputs);
+    else
+      positions[node] = optimized.addNode(graph.getWorker(node), inputs);
+  }
+
+  return optimized;
+}
+
+void Workflow::setIncrementalState(const std::string& stateFile) {
+  incrementalState = stateFile;
+}
+
+void Workflow::setResultCache(std::shared_ptr<const ResultCache> cache) {
+  resultCache = cache;
+}
 
-  // Проверяем наличие чтения из файла
-  if (worker->getAcceptType() != WorkerResult::NONE) {
-    if (ifname == "")
-      throw WorkerExecuteException("No input file set.");
-    workers::ReadFile reader(0, ifname);
-    lastResult = reader.execute(lastResult);
+void Workflow::setMemoryBudget(std::shared_ptr<MemoryBudget> budget) {
+  memoryBudget = budget;
+}
+
+/**
+ * Во сколько раз память исполнения в среднем превышает размер входа:
+ * кроме байт строк место занимают ссылки на них, рабочая память
+ * сортировки и промежуточные результаты.
+ */
+static const uint64_t MEMORY_PER_INPUT_BYTE = 4;
+
+/**
+ * @return true, если текст входных файлов, вероятно, не поместится
+ * в свободную память. Размер стандартного ввода неизвестен заранее.
+ */
+static bool exceedsMemory(const workers::ReadFile& reader,
+                          const MemoryBudget& budget) {
+  uint64_t total = 0;
+  for (auto const& filename : reader.getFilenames()) {
+    struct stat info;
+    if (filename == workers::STANDARD_STREAM)
+      return true;
+    if (stat(filename.c_str(), &info) == 0)
+      total += info.st_size;
   }
+  return total * MEMORY_PER_INPUT_BYTE > budget.getAvailable();
+}
 
-  // Выполняем инструкции
-  do
-    lastResult = worker->execute(lastResult);
-  while ((worker = parser.nextInstruction()));
+void Workflow::setInputFiles(const std::vector<std::string>& patterns,
+                             const workers::ReadFile::Mode mode) {
+  reader.reset(new workers::ReadFile(0, patterns, mode));
+  buildGraph();
+}
+
+const ExecutionGraph& Workflow::getGraph() const
+    throw(WorkerExecuteException) {
+  if (graphError != "")
+    throw WorkerExecuteException(graphError);
+  return graph;
+}
+
+void Workflow::buildGraph() {
+  graphError = "";
+  chain.clear();
+  parts = LinearChain();
+  streamable = false;
+  try {
+    graph = composeGraph();
+  } catch (const WorkerExecuteException& e) {
+    graph = ExecutionGraph();
+    graphError = e.what();
+    return;
+  }
+
+  if (!graph.isChain())
+    return;
+  for (size_t node = 0; node < graph.size(); node++)
+    chain.push_back(graph.getWorker(node));
+  streamable = parts.parse(chain) == chain.size() &&
+               parts.writer != nullptr &&
+               parts.reader->getMode() != workers::ReadFile::Mode::MERGE;
+}
+
+ExecutionGraph Workflow::composeGraph() const throw(WorkerExecuteException) {
+  ExecutionGraph graph;
+  std::vector<size_t> nodes(parser->getInstructionsCount());
+  bool reading = false;
+  size_t input = 0;
+
+  for (size_t i = 0; i < nodes.size(); i++) {
+    const Worker* worker = parser->getInstruction(i);
+    std::vector<size_t> inputs;
+    for (auto position : parser->getInstructionInputs(i))
+      inputs.push_back(nodes[position]);
+
+    // Проверяем наличие чтения из файла
+    if (inputs.empty() && worker->getAcceptType() != WorkerResult::NONE) {
+      if (reader->getFilename() == "")
+        throw WorkerExecuteException("No input file set.");
+      if (!reading)
+        input = graph.addNode(reader.get(), std::vector<size_t>());
+      reading = true;
+      inputs.push_back(input);
+    }
+
+    nodes[i] = graph.addNode(worker, inputs);
+  }
 
   // Проверяем наличие записи в файл
-  if (lastResult.getType() != WorkerResult::NONE) {
+  std::vector<size_t> outputs;
+  for (size_t node = 0; node < graph.size(); node++)
+    if (graph.getOutputs(node).empty() &&
+        graph.getWorker(node)->getReturnType() != WorkerResult::NONE)
+      outputs.push_back(node);
+
+  if (outputs.size() > 1)
+    throw WorkerExecuteException(
+        "Several workflow outputs are not written to files.");
+  if (outputs.size() == 1) {
     if (ofname == "")
       throw WorkerExecuteException("No output file set.");
-    workers::WriteFile writer(0, ofname);
-    writer.execute(lastResult);
+    graph.addNode(&writer, outputs);
   }
+
+  return optimizeGraph(graph);
+}
+
+void Workflow::execute() throw(WorkerExecuteException) {
+  const ExecutionGraph& graph = getGraph();
+
+  if (incrementalState != "") {
+    if (!graph.isChain())
+      throw WorkerExecuteException(
+          "Incremental mode requires a linear workflow.");
+    executeIncremental(chain, incrementalState);
+    return;
+  }
+
+  // Линейную схему можно исполнить потоково, если вход не помещается
+  // в память
+  const bool streaming = memoryBudget && streamable;
+  if (streaming && exceedsMemory(*parts.reader, *memoryBudget)) {
+    executeStreaming(parts, memoryBudget);
+    return;
+  }
+
+  // Результаты блоков кэшируются целиком, без кэша линейная схема
+  // исполняется лениво. Если память кончилась до записи результата,
+  // схема исполняется заново потоково
+  if (!resultCache && graph.isChain()) {
+    try {
+      executeLazy(chain, memoryBudget);
+      return;
+    } catch (const MemoryLimitException&) {
+      if (!streaming)
+        throw;
+    } catch (const WorkerExecuteException&) {
+      throw;
+    } catch (const std::exception& e) {
+      throw WorkerExecuteException(e.what());
+    }
+    executeStreaming(parts, memoryBudget);
+    return;
+  }
+
+  std::map<size_t, std::string> errors =
+      graph.execute(resultCache, memoryBudget);
+
+  // Оценка размера оказалась слишком оптимистичной: запись результата -
+  // последний блок схемы, поэтому ее можно исполнить заново потоково
+  if (streaming && errors.size() == 1 &&
+      errors.begin()->second == MemoryLimitException().what()) {
+    executeStreaming(parts, memoryBudget);
+    return;
+  }
+
+  if (!errors.empty())
+    throw WorkerExecuteException(errors.begin()->second);
 }
 
 }  // namespace wkfw
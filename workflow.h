@@ -12,10 +12,15 @@
 #include <exception>
 #include <istream>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "execution_graph.h"
+#include "result_cache.h"
+#include "streaming.h"
 #include "worker.h"
+#include "workers.h"
 #include "workflow_parser.h"
 
 namespace wkfw {
@@ -29,15 +34,104 @@ class Workflow {
            const std::string& ifname,
            const std::string& ofname) throw(InvalidWorkflowException);
 
+  /**
+   * Создает Workflow по уже разобранному описанию.
+   * Одно описание может использоваться несколькими Workflow одновременно.
+   */
+  Workflow(std::shared_ptr<const WorkflowParser> parser,
+           const std::string& ifname,
+           const std::string& ofname);
+
+  Workflow(const Workflow&) = delete;
+  Workflow& operator=(const Workflow&) = delete;
+
+  /**
+   * Включает кэширование результатов детерминированных блоков.
+   * При повторном запуске пропускается самый длинный префикс конвейера,
+   * результат которого уже есть в кэше.
+   *
+   * @param cache Кэш результатов или nullptr, чтобы выключить кэширование.
+   */
+  void setResultCache(std::shared_ptr<const ResultCache> cache);
+
+  /**
+   * Включает инкрементальное исполнение: обрабатываются только строки,
+   * дописанные во входной файл с предыдущего запуска.
+   *
+   * @param stateFile Файл состояния между запусками или пустая строка,
+   * чтобы выключить инкрементальное исполнение.
+   */
+  void setIncrementalState(const std::string& stateFile);
+
+  /**
+   * Ограничивает память исполнения. Если входные файлы не поместятся
+   * в свободную память или исполнение в памяти превысит ограничение,
+   * линейная схема вида
+   * readfile -> построчные блоки -> [sort -> построчные блоки] -> writefile
+   * исполняется потоково, а сортировка сбрасывает части на диск
+   * (см. executeStreaming). Иначе схема исполняется в памяти, и блок,
+   * превысивший ограничение, завершается ошибкой.
+   *
+   * @param budget Учет памяти, может разделяться несколькими Workflow,
+   * или nullptr, чтобы снять ограничение.
+   */
+  void setMemoryBudget(std::shared_ptr<MemoryBudget> budget);
+
+  /**
+   * Задает несколько входных файлов вместо одного, переданного
+   * в конструкторе. Файлы читаются параллельно (см. workers::ReadFile).
+   *
+   * @param patterns Имена входных файлов и шаблоны имен.
+   * @param mode Способ объединения строк файлов.
+   */
+  void setInputFiles(const std::vector<std::string>& patterns,
+                     const workers::ReadFile::Mode mode);
+
+  /**
+   * Граф исполнения: инструкции схемы, дополненные чтением
+   * входного и записью выходного файла, если их нет в схеме.
+   * Все инструкции без входов, принимающие текст, читают общие входные файлы.
+   * Ограничения head/tail по возможности переносятся в чтение файла и
+   * сортировку (см. workers::LimitedRead, workers::Top).
+   *
+   * Граф составляется один раз при создании Workflow и при смене входных
+   * файлов, повторные исполнения используют его же.
+   *
+   * @throw WorkerExecuteException Если граф не удалось составить.
+   */
+  const ExecutionGraph& getGraph() const throw(WorkerExecuteException);
+
   /**
    * Запустить выполнение инструкций.
    * */
   void execute() throw(WorkerExecuteException);
 
  private:
-  const std::string ifname;
+  std::shared_ptr<const WorkflowParser> parser;
   const std::string ofname;
-  WorkflowParser parser;
+  std::unique_ptr<const workers::ReadFile> reader;
+  const workers::WriteFile writer;
+  std::shared_ptr<const ResultCache> resultCache;
+  std::string incrementalState;
+  std::shared_ptr<MemoryBudget> memoryBudget;
+  ExecutionGraph graph;
+  // Ошибка составления графа, сообщается при исполнении
+  std::string graphError;
+  // Блоки линейной схемы в порядке исполнения, иначе пусто
+  std::vector<const Worker*> chain;
+  // Части линейной схемы для потокового исполнения
+  LinearChain parts;
+  bool streamable;
+
+  /**
+   * Составляет граф исполнения и разбирает его, если схема линейная.
+   */
+  void buildGraph();
+
+  /**
+   * @return Граф исполнения (см. getGraph()).
+   */
+  ExecutionGraph composeGraph() const throw(WorkerExecuteException);
 };
 
 }  // namespace wkfw
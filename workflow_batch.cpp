@@ -0,0 +1,67 @@
+//
+//  workflow_batch.cpp
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "workflow_batch.h"
+
+namespace wkfw {
+
+void WorkflowBatch::add(const std::string& name,
+                        std::shared_ptr<const Workflow> workflow)
+    throw(WorkerExecuteException) {
+  const size_t owner = workflows.size();
+  ExecutionGraph own = workflow->getGraph();
+  std::vector<std::string> keys = own.getKeys();
+  std::vector<size_t> nodes(own.size());
+
+  for (size_t node = 0; node < own.size(); node++) {
+    auto found = keys[node] == "" ? shared.end() : shared.find(keys[node]);
+    if (found != shared.end()) {
+      nodes[node] = found->second;
+    } else {
+      std::vector<size_t> inputs;
+      for (auto input : own.getInputs(node))
+        inputs.push_back(nodes[input]);
+      if (own.getOwnedWorker(node))
+        nodes[node] = graph.addNode(own.getOwnedWorker(node), inputs);
+      else
+        nodes[node] = graph.addNode(own.getWorker(node), inputs);
+      owners.push_back(std::vector<size_t>());
+      if (keys[node] != "")
+        shared[keys[node]] = nodes[node];
+    }
+    owners[nodes[node]].push_back(owner);
+  }
+
+  names.push_back(name);
+  workflows.push_back(workflow);
+}
+
+void WorkflowBatch::setResultCache(std::shared_ptr<const ResultCache> cache) {
+  resultCache = cache;
+}
+
+void WorkflowBatch::setMemoryBudget(std::shared_ptr<MemoryBudget> budget) {
+  memoryBudget = budget;
+}
+
+void WorkflowBatch::execute() throw(WorkerExecuteException) {
+  std::map<size_t, std::string> errors =
+      graph.execute(resultCache, memoryBudget);
+
+  if (errors.empty())
+    return;
+
+  std::string message;
+  for (auto const& error : errors)
+    for (auto owner : owners[error.first])
+      message += (message.empty() ? "" : "\n") + names[owner] + ": " +
+                 error.second;
+  throw WorkerExecuteException(message);
+}
+
+}  // namespace wkfw
@@ -0,0 +1,78 @@
+//
+//  workflow_batch.h
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef WORKFLOW_BATCH_H_
+#define WORKFLOW_BATCH_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "execution_graph.h"
+#include "workflow.h"
+
+namespace wkfw {
+
+/**
+ * Совместное исполнение нескольких Workflow.
+ *
+ * Графы исполнения объединяются в один: блоки с одинаковыми отпечатками
+ * (Worker::getFingerprint()) над одинаковыми входными данными исполняются
+ * один раз, в том числе чтение общего входного файла.
+ * Блоки с побочными эффектами исполняются для каждого Workflow отдельно.
+ */
+class WorkflowBatch {
+ public:
+  /**
+   * Добавляет Workflow в набор.
+   *
+   * @param name Название для сообщений об ошибках.
+   */
+  void add(const std::string& name, std::shared_ptr<const Workflow> workflow)
+      throw(WorkerExecuteException);
+
+  /**
+   * Включает кэширование результатов детерминированных блоков.
+   */
+  void setResultCache(std::shared_ptr<const ResultCache> cache);
+
+  /**
+   * Ограничивает память исполнения. Объединенный граф исполняется
+   * в памяти, блок, превысивший ограничение, завершается ошибкой.
+   */
+  void setMemoryBudget(std::shared_ptr<MemoryBudget> budget);
+
+  /**
+   * Исполняет все Workflow. Ошибка в одном Workflow не прерывает остальные.
+   *
+   * @throws WorkerExecuteException со списком ошибок всех неудавшихся Workflow.
+   */
+  void execute() throw(WorkerExecuteException);
+
+  /**
+   * @return Количество узлов объединенного графа - блоков, исполняемых
+   * с учетом объединения общих частей.
+   */
+  size_t getNodesCount() const { return graph.size(); }
+
+ private:
+  std::vector<std::string> names;
+  std::vector<std::shared_ptr<const Workflow>> workflows;
+  std::shared_ptr<const ResultCache> resultCache;
+  std::shared_ptr<MemoryBudget> memoryBudget;
+  ExecutionGraph graph;
+  // Узлы объединенного графа по ключам их результатов
+  std::map<std::string, size_t> shared;
+  // Workflow, которым принадлежат узлы
+  std::vector<std::vector<size_t>> owners;
+};
+
+}  // namespace wkfw
+
+#endif /* WORKFLOW_BATCH_H_ */
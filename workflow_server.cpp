@@ -0,0 +1,455 @@
+//
+//  workflow_server.cpp
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <set>
+#include <sstream>
+
+#include "workflow.h"
+#include "workflow_server.h"
+
+namespace wkfw {
+
+std::shared_ptr<const WorkflowParser> PlanCache::find(const size_t hash,
+                                                      const std::string& text) {
+  auto range = index.equal_range(hash);
+  for (auto i = range.first; i != range.second; i++) {
+    if (i->second->first == text) {
+      entries.splice(entries.begin(), entries, i->second);
+      return i->second->second;
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<const WorkflowParser> PlanCache::get(
+    const std::string& text) throw(InvalidWorkflowException) {
+  const size_t hash = std::hash<std::string>()(text);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = find(hash, text);
+    if (found)
+      return found;
+  }
+
+  // Разбираем без блокировки, чтобы не задерживать попадания в кэш
+  std::istringstream stream(text);
+  std::shared_ptr<const WorkflowParser> parser =
+      std::make_shared<WorkflowParser>(stream);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto found = find(hash, text);
+  if (found)
+    return found;
+
+  entries.push_front(Entry(text, parser));
+  index.insert(std::make_pair(hash, entries.begin()));
+
+  if (entries.size() > capacity) {
+    const size_t oldest = std::hash<std::string>()(entries.back().first);
+    auto range = index.equal_range(oldest);
+    for (auto i = range.first; i != range.second; i++) {
+      if (i->second == std::prev(entries.end())) {
+        index.erase(i);
+        break;
+      }
+    }
+    entries.pop_back();
+  }
+
+  return parser;
+}
+
+size_t PlanCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+/**
+ * Ждет готовности соединения к чтению или записи не дольше, чем до срока.
+ *
+ * @return false, если срок истек или соединение закрыто.
+ */
+static bool waitReady(const int connection,
+                      const short events,
+                      const std::chrono::steady_clock::time_point deadline) {
+  while (true) {
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (left.count() <= 0)
+      return false;
+
+    struct pollfd descriptor;
+    descriptor.fd = connection;
+    descriptor.events = events;
+    descriptor.revents = 0;
+    const int ready = poll(&descriptor, 1, left.count());
+    if (ready < 0 && errno == EINTR)
+      continue;
+    return ready > 0;
+  }
+}
+
+/**
+ * Буферизованное чтение запросов из соединения.
+ *
+ * Чтения и записи ждут соединение не дольше общего срока (см. startTimer),
+ * поэтому клиент, присылающий запрос по байту, не занимает поток дольше
+ * заданного времени.
+ */
+class ConnectionReader {
+ public:
+  ConnectionReader(const int connection) : connection(connection) {}
+
+  /**
+   * Начинает отсчет срока последующих чтений и записей.
+   *
+   * @param timeout Секунды до срока.
+   */
+  void startTimer(const int timeout) {
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout);
+  }
+
+  /**
+   * Считывает строку до символа переноса строки (не включая его).
+   */
+  bool readLine(std::string& line) {
+    line.clear();
+    while (true) {
+      const char* begin = buffer.data() + position;
+      const char* end = buffer.data() + buffer.size();
+      const char* found = std::find(begin, end, '\n');
+      if (found != end) {
+        line.append(begin, found);
+        position += found - begin + 1;
+        return true;
+      }
+      line.append(begin, end);
+      position = buffer.size();
+      if (!fill())
+        return false;
+    }
+  }
+
+  /**
+   * Считывает ровно size байт.
+   */
+  bool read(std::string& data, size_t size) {
+    data.clear();
+    data.reserve(size);
+    while (data.size() < size) {
+      if (position == buffer.size() && !fill())
+        return false;
+      size_t chunk = std::min(size - data.size(), buffer.size() - position);
+      data.append(buffer.data() + position, chunk);
+      position += chunk;
+    }
+    return true;
+  }
+
+  /**
+   * Отправляет ответ до срока.
+   */
+  bool write(const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+      if (!waitReady(connection, POLLOUT, deadline))
+        return false;
+      ssize_t count = send(connection, data.data() + written,
+                           data.size() - written, MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (count < 0 && (errno == EINTR || errno == EAGAIN))
+        continue;
+      if (count <= 0)
+        return false;
+      written += count;
+    }
+    return true;
+  }
+
+  /**
+   * @return true, если в буфере есть непрочитанные байты.
+   */
+  bool hasBuffered() const { return position < buffer.size(); }
+
+ private:
+  const int connection;
+  std::string buffer;
+  size_t position = 0;
+  std::chrono::steady_clock::time_point deadline;
+
+  bool fill() {
+    char chunk[64 * 1024];
+    ssize_t count;
+    do {
+      if (!waitReady(connection, POLLIN, deadline))
+        return false;
+      count = recv(connection, chunk, sizeof(chunk), MSG_DONTWAIT);
+    } while (count < 0 && (errno == EINTR || errno == EAGAIN));
+    if (count <= 0)
+      return false;
+    buffer.assign(chunk, count);
+    position = 0;
+    return true;
+  }
+};
+
+/**
+ * Разбирает длину описания: только цифры, не больше MAX_WORKFLOW_LENGTH.
+ */
+static bool parseLength(const std::string& text, size_t& length) {
+  length = 0;
+  for (char symbol : text) {
+    if (symbol < '0' || symbol > '9')
+      return false;
+    length = length * 10 + (symbol - '0');
+    if (length > WorkflowServer::MAX_WORKFLOW_LENGTH)
+      return false;
+  }
+  return !text.empty();
+}
+
+WorkflowServer::WorkflowServer(const std::string& socketPath,
+                               const size_t threads,
+                               const size_t cacheCapacity) throw(ServerException)
+    : socketPath(socketPath),
+      listener(-1),
+      stopping(false),
+      cache(cacheCapacity),
+      requestTimeout(REQUEST_TIMEOUT),
+      pool(new ThreadPool(threads)) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path))
+    throw ServerException("Socket path is too long: \"" + socketPath + "\"");
+  strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0)
+    throw ServerException("Cannot create socket.");
+
+  // Заменяем только сокет, оставшийся от завершившегося сервера
+  struct stat info;
+  if (lstat(socketPath.c_str(), &info) == 0) {
+    if (!S_ISSOCK(info.st_mode)) {
+      close(listener);
+      throw ServerException("File \"" + socketPath + "\" is not a socket.");
+    }
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool listening = probe >= 0 && connect(probe, (struct sockaddr*)&address,
+                                           sizeof(address)) == 0;
+    if (probe >= 0)
+      close(probe);
+    if (listening) {
+      close(listener);
+      throw ServerException("Socket \"" + socketPath +
+                            "\" is already in use.");
+    }
+    unlink(socketPath.c_str());
+  }
+
+  if (bind(listener, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+      listen(listener, SOMAXCONN) < 0) {
+    close(listener);
+    throw ServerException("Cannot listen on socket \"" + socketPath + "\"");
+  }
+
+  if (pipe(wakeup) < 0) {
+    close(listener);
+    unlink(socketPath.c_str());
+    throw ServerException("Cannot create wakeup pipe.");
+  }
+  for (int end : wakeup)
+    fcntl(end, F_SETFL, fcntl(end, F_GETFL) | O_NONBLOCK);
+}
+
+void WorkflowServer::setResultCache(std::shared_ptr<const ResultCache> cache) {
+  resultCache = cache;
+}
+
+void WorkflowServer::setRequestTimeout(const int seconds) {
+  requestTimeout = seconds;
+}
+
+void WorkflowServer::setMemoryBudget(std::shared_ptr<MemoryBudget> budget) {
+  memoryBudget = budget;
+}
+
+void WorkflowServer::run() {
+  // Соединения, в которых ожидаются запросы
+  std::set<int> waiting;
+  std::vector<struct pollfd> descriptors;
+
+  while (!stopping) {
+    descriptors.clear();
+    descriptors.push_back({listener, POLLIN, 0});
+    descriptors.push_back({wakeup[0], POLLIN, 0});
+    for (int connection : waiting)
+      descriptors.push_back({connection, POLLIN, 0});
+
+    if (poll(descriptors.data(), descriptors.size(), -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    if (descriptors[1].revents != 0) {
+      char drain[256];
+      while (read(wakeup[0], drain, sizeof(drain)) > 0)
+        continue;
+      std::lock_guard<std::mutex> lock(connectionsMutex);
+      waiting.insert(returned.begin(), returned.end());
+      returned.clear();
+    }
+
+    for (size_t i = 2; i < descriptors.size(); i++) {
+      if (descriptors[i].revents == 0)
+        continue;
+      waiting.erase(descriptors[i].fd);
+      pool->submit(
+          std::bind(&WorkflowServer::serve, this, descriptors[i].fd));
+    }
+
+    if (descriptors[0].revents == 0)
+      continue;
+    int connection = accept(listener, nullptr, nullptr);
+    if (connection < 0) {
+      if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN)
+        continue;
+      break;
+    }
+
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    connections[connection].reset(new ConnectionReader(connection));
+    waiting.insert(connection);
+  }
+
+  // Прерываем ожидание запросов в открытых соединениях
+  std::lock_guard<std::mutex> lock(connectionsMutex);
+  for (auto const& connection : connections)
+    shutdown(connection.first, SHUT_RDWR);
+}
+
+void WorkflowServer::stop() {
+  stopping = true;
+  shutdown(listener, SHUT_RDWR);
+  wake();
+}
+
+void WorkflowServer::wake() {
+  const char signal = 0;
+  ssize_t written = write(wakeup[1], &signal, 1);
+  (void)written;
+}
+
+WorkflowServer::~WorkflowServer() {
+  stop();
+  {
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    for (auto const& connection : connections)
+      shutdown(connection.first, SHUT_RDWR);
+  }
+
+  // Дожидаемся задач до закрытия дескрипторов, которыми они пользуются
+  pool.reset();
+  for (auto const& connection : connections)
+    close(connection.first);
+  close(listener);
+  close(wakeup[0]);
+  close(wakeup[1]);
+  unlink(socketPath.c_str());
+}
+
+void WorkflowServer::serve(const int connection) {
+  ConnectionReader* reader;
+  {
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    reader = connections[connection].get();
+  }
+
+  std::string ifname;
+  std::string ofname;
+  std::string length;
+  std::string text;
+  bool open = false;
+  reader->startTimer(requestTimeout);
+
+  // Ошибка одного запроса закрывает только его соединение
+  try {
+    if (reader->readLine(ifname) && reader->readLine(ofname) &&
+        reader->readLine(length)) {
+      size_t size;
+      if (!parseLength(length, size))
+        reader->write("ERROR Invalid workflow length.\n");
+      else if (reader->read(text, size)) {
+        // Исполнение не входит в срок запроса, ответ получает свой
+        const std::string response = process(text, ifname, ofname);
+        reader->startTimer(requestTimeout);
+        open = reader->write(response);
+      }
+    }
+  } catch (const std::exception& e) {
+    reader->write(std::string("ERROR ") + e.what() + "\n");
+    open = false;
+  } catch (...) {
+    open = false;
+  }
+
+  release(connection, open);
+}
+
+void WorkflowServer::release(const int connection, const bool open) {
+  std::lock_guard<std::mutex> lock(connectionsMutex);
+  if (!open) {
+    connections.erase(connection);
+    close(connection);
+    return;
+  }
+
+  // Следующий запрос уже прочитан в буфер: сокет о нем не сообщит
+  if (connections[connection]->hasBuffered() && !stopping) {
+    pool->submit(std::bind(&WorkflowServer::serve, this, connection));
+    return;
+  }
+
+  returned.push_back(connection);
+  wake();
+}
+
+std::string WorkflowServer::process(const std::string& text,
+                                    const std::string& ifname,
+                                    const std::string& ofname) {
+  try {
+    Workflow workflow(cache.get(text), ifname, ofname);
+    workflow.setResultCache(resultCache);
+    workflow.setMemoryBudget(memoryBudget);
+    workflow.execute();
+    return "OK\n";
+  } catch (const InvalidWorkflowException& e) {
+    return std::string("ERROR InvalidWorkflowException: ") + e.what() + "\n";
+  } catch (const WorkerExecuteException& e) {
+    return std::string("ERROR WorkerExecuteException: ") + e.what() + "\n";
+  } catch (const std::exception& e) {
+    return std::string("ERROR ") + e.what() + "\n";
+  }
+}
+
+}  // namespace wkfw
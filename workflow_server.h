@@ -0,0 +1,195 @@
+//
+//  workflow_server.h
+//  Workflow
+//
+//  Created by agent on 19.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef WORKFLOW_SERVER_H_
+#define WORKFLOW_SERVER_H_
+
+#include <atomic>
+#include <exception>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "result_cache.h"
+#include "thread_pool.h"
+#include "workflow_parser.h"
+
+namespace wkfw {
+
+/**
+ * Бросается при ошибках работы с сокетом сервера.
+ */
+class ServerException : public std::exception {
+ public:
+  ServerException(const std::string& description) : description(description) {}
+
+  const char* what() const throw() override { return description.c_str(); }
+
+ private:
+  const std::string description;
+};
+
+/**
+ * Кэш разобранных описаний Workflow.
+ * Ключ - хэш текста описания, при совпадении хэшей сравнивается сам текст.
+ * При переполнении вытесняется давно не использованное описание.
+ */
+class PlanCache {
+ public:
+  PlanCache(const size_t capacity) : capacity(capacity) {}
+
+  /**
+   * Получает разобранное описание по его тексту, разбирая его при промахе.
+   */
+  std::shared_ptr<const WorkflowParser> get(const std::string& text) throw(
+      InvalidWorkflowException);
+
+  /**
+   * @return Количество описаний в кэше.
+   */
+  size_t size() const;
+
+ private:
+  typedef std::pair<std::string, std::shared_ptr<const WorkflowParser>> Entry;
+
+  const size_t capacity;
+  // Первый элемент - последний использованный
+  std::list<Entry> entries;
+  std::unordered_multimap<size_t, std::list<Entry>::iterator> index;
+  mutable std::mutex mutex;
+
+  std::shared_ptr<const WorkflowParser> find(const size_t hash,
+                                             const std::string& text);
+};
+
+class ConnectionReader;
+
+/**
+ * Долгоживущий процесс, исполняющий Workflow по запросам через
+ * Unix domain socket.
+ *
+ * Запрос (в одном соединении допускается несколько запросов подряд):
+ *
+ *   <входной файл>\n
+ *   <выходной файл>\n
+ *   <длина описания в байтах>\n
+ *   <описание Workflow>
+ *
+ * Пустая строка вместо имени файла означает его отсутствие.
+ * Ответ: "OK\n" или "ERROR <описание ошибки>\n".
+ *
+ * Поток run() принимает соединения и ждет в них запросов. Каждый пришедший
+ * запрос исполняется отдельной задачей пула, после ответа соединение
+ * возвращается потоку приема, поэтому простаивающие соединения
+ * не занимают потоки пула.
+ */
+class WorkflowServer {
+ public:
+  /**
+   * Максимальная длина описания в запросе.
+   */
+  static const size_t MAX_WORKFLOW_LENGTH = 16 << 20;
+
+  /**
+   * Секунды по умолчанию, за которые клиент должен дослать начатый запрос
+   * и, отдельно, принять ответ.
+   */
+  static const int REQUEST_TIMEOUT = 30;
+
+  /**
+   * Если по пути сокета уже есть файл, он заменяется, только если это
+   * сокет, который никто не слушает.
+   *
+   * @param socketPath Путь к сокету.
+   * @param threads Количество потоков исполнения. Если 0 - по числу ядер.
+   * @param cacheCapacity Максимальное количество описаний в кэше.
+   */
+  WorkflowServer(const std::string& socketPath,
+                 const size_t threads = 0,
+                 const size_t cacheCapacity = 1024) throw(ServerException);
+
+  WorkflowServer(const WorkflowServer&) = delete;
+  WorkflowServer& operator=(const WorkflowServer&) = delete;
+
+  /**
+   * Включает кэширование результатов для всех исполняемых Workflow.
+   */
+  void setResultCache(std::shared_ptr<const ResultCache> cache);
+
+  /**
+   * Ограничивает память, общую для всех исполняемых Workflow.
+   */
+  void setMemoryBudget(std::shared_ptr<MemoryBudget> budget);
+
+  /**
+   * Задает срок запроса (см. REQUEST_TIMEOUT). Вызывается до run().
+   */
+  void setRequestTimeout(const int seconds);
+
+  /**
+   * Принимает соединения до вызова stop().
+   */
+  void run();
+
+  /**
+   * Прекращает прием соединений.
+   * Допускается вызов из обработчика сигнала.
+   */
+  void stop();
+
+  ~WorkflowServer();
+
+ private:
+  const std::string socketPath;
+  int listener;
+  // Канал, которым задачи и stop() будят поток приема
+  int wakeup[2];
+  std::atomic<bool> stopping;
+  PlanCache cache;
+  int requestTimeout;
+  std::shared_ptr<const ResultCache> resultCache;
+  std::shared_ptr<MemoryBudget> memoryBudget;
+  // Открытые соединения и их буферы чтения
+  std::map<int, std::unique_ptr<ConnectionReader>> connections;
+  // Соединения, ответившие на запрос и ожидающие следующего
+  std::vector<int> returned;
+  std::mutex connectionsMutex;
+  std::unique_ptr<ThreadPool> pool;
+
+  /**
+   * Обслуживает один запрос соединения.
+   */
+  void serve(const int connection);
+
+  /**
+   * Возвращает соединение потоку приема или закрывает его.
+   */
+  void release(const int connection, const bool open);
+
+  /**
+   * Будит поток приема. Допускается вызов из обработчика сигнала.
+   */
+  void wake();
+
+  /**
+   * Исполняет один запрос.
+   *
+   * @return Ответ клиенту.
+   */
+  std::string process(const std::string& text,
+                      const std::string& ifname,
+                      const std::string& ofname);
+};
+
+}  // namespace wkfw
+
+#endif /* WORKFLOW_SERVER_H_ */